@@ -0,0 +1,10 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Inventory/Item/XIUCapacityFragment.h"
+
+bool UXIUCapacityFragment::NeedsInstanceCreated() const
+{
+	// data only
+	return IsOnInstanceCreatedImplementedInScript();
+}
@@ -0,0 +1,236 @@
+// Copyright XyloIsCoding 2024
+
+
+#include "Inventory/Item/XIUContainerItem.h"
+
+#include "Net/UnrealNetwork.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+
+UXIUContainerItem::UXIUContainerItem(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	Contents.OwnerContainer = this;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * UObject Interface
+ */
+
+void UXIUContainerItem::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(ThisClass, Contents);
+	DOREPLIFETIME(ThisClass, ContentsSlotSettings);
+}
+
+void UXIUContainerItem::BeginDestroy()
+{
+	Contents.ClearItemOwners();
+	
+	Super::BeginDestroy();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * UXIUItem Interface
+ */
+
+bool UXIUContainerItem::CanStack(UXIUItem* Item)
+{
+	return false;
+}
+
+UXIUItem* UXIUContainerItem::Duplicate(UObject* Outer)
+{
+	UXIUContainerItem* Copy = Cast<UXIUContainerItem>(Super::Duplicate(Outer));
+	if (!Copy) return nullptr;
+
+	// the copy has no inventory yet, so it only gets to load the contents once attached
+	if (Contents.GetSize() > 0)
+	{
+		FMemoryWriter Writer(Copy->PendingContents);
+		Contents.SaveSnapshot(Writer);
+	}
+	else
+	{
+		Copy->PendingContents = PendingContents;
+	}
+	return Copy;
+}
+
+void UXIUContainerItem::SerializeSnapshotData(FArchive& Ar)
+{
+	Super::SerializeSnapshotData(Ar);
+
+	if (Ar.IsSaving())
+	{
+		TArray<uint8> Data;
+		if (Contents.GetSize() > 0)
+		{
+			FMemoryWriter Writer(Data);
+			Contents.SaveSnapshot(Writer);
+		}
+		else
+		{
+			Data = PendingContents;
+		}
+		Ar << Data;
+	}
+	else
+	{
+		// called before the container is placed in the restored slot, so we load the contents once attached.
+		// the size comes from the archive, so we make sure the data is there before allocating it
+		int32 Num = 0;
+		Ar << Num;
+		if (Ar.IsError() || Num < 0 || Num > Ar.TotalSize() - Ar.Tell())
+		{
+			Ar.SetError();
+			return;
+		}
+		PendingContents.SetNumUninitialized(Num);
+		Ar.Serialize(PendingContents.GetData(), Num);
+	}
+}
+
+void UXIUContainerItem::DestroyActiveState()
+{
+	if (CanManipulateContents())
+	{
+		if (ParentList) ParentList->DetachContainer(this);
+		for (int32 SlotIndex = 0; SlotIndex < Contents.GetSize(); SlotIndex++)
+		{
+			Contents.RemoveItemAtSlot(SlotIndex);
+		}
+	}
+
+	Super::DestroyActiveState();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * ContainerItem
+ */
+
+int32 UXIUContainerItem::CountContentsByDefinition(const UXIUItemDefinition* ItemDefinition) const
+{
+	const int32* Count = AggregateCounts.Find(ItemDefinition);
+	return Count ? *Count : 0;
+}
+
+UXIUItem* UXIUContainerItem::GetItemAtSlot(const int32 SlotIndex)
+{
+	if (SlotIndex < 0 || SlotIndex >= Contents.GetSize()) return nullptr;
+	return Contents.GetItemAtSlot(SlotIndex);
+}
+
+int32 UXIUContainerItem::AddItemDefault(FXIUItemDefault ItemDefault, TArray<UXIUItem*>& AddedItems)
+{
+	if (!CanManipulateContents())
+	{
+		UE_LOG(LogTemp, Error, TEXT("UXIUContainerItem::AddItemDefault -> [%s] is not in an inventory owned by the server"), *GetName())
+		return ItemDefault.Count;
+	}
+	return Contents.AddItemDefault(ItemDefault, AddedItems);
+}
+
+int32 UXIUContainerItem::AddItem(UXIUItem* Item, int32 CountOverride, bool bDuplicate, bool bModifyItemCount, UXIUItem*& AddedItem)
+{
+	AddedItem = nullptr;
+	if (!Item || Item == this) return 0;
+	if (!CanManipulateContents())
+	{
+		UE_LOG(LogTemp, Error, TEXT("UXIUContainerItem::AddItem -> [%s] is not in an inventory owned by the server"), *GetName())
+		return CountOverride > 0 ? CountOverride : Item->GetCount();
+	}
+	return Contents.AddItem(Item, CountOverride, bDuplicate, bModifyItemCount, AddedItem);
+}
+
+bool UXIUContainerItem::CanManipulateContents() const
+{
+	return ParentList && Contents.CanManipulateInventory();
+}
+
+void UXIUContainerItem::OnRep_ContentsSlotSettings()
+{
+	Contents.OnSettingsPaletteReplicated();
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Attachment */
+
+void UXIUContainerItem::OnAttached()
+{
+	if (Contents.CanManipulateInventory())
+	{
+		if (!PendingContents.IsEmpty())
+		{
+			FMemoryReader Reader(PendingContents);
+			if (!Contents.LoadSnapshot(Reader))
+			{
+				UE_LOG(LogTemp, Error, TEXT("UXIUContainerItem::OnAttached -> Contents of [%s] are corrupted"), *GetName())
+			}
+			PendingContents.Empty();
+		}
+
+		if (Contents.GetSize() == 0)
+		{
+			Contents.InitInventory(ContainerSize);
+			return;
+		}
+
+		// contents might have been registered to the replicator of another inventory
+		for (const FXIUInventorySlot& Slot : Contents.GetInventory())
+		{
+			if (UXIUItem* Item = Slot.GetItem()) Contents.RegisterSlotItem(Slot, Item);
+		}
+		return;
+	}
+
+	// contents replicated before the container reached an inventory were not observed yet
+	if (!bContentsObserved)
+	{
+		bContentsObserved = true;
+		TArray<int32> AddedIndices;
+		for (int32 Index = 0; Index < Contents.Entries.Num(); Index++)
+		{
+			AddedIndices.Add(Index);
+		}
+		if (!AddedIndices.IsEmpty()) Contents.PostReplicatedAdd(AddedIndices, Contents.Entries.Num());
+	}
+}
+
+void UXIUContainerItem::ApplyContentsDelta(const UXIUItemDefinition* ItemDefinition, const int32 CountDelta, const FXIUInventoryLoad& LoadDelta)
+{
+	if (ItemDefinition && CountDelta != 0)
+	{
+		int32& AggregateCount = AggregateCounts.FindOrAdd(ItemDefinition);
+		AggregateCount += CountDelta;
+		if (AggregateCount == 0) AggregateCounts.Remove(ItemDefinition);
+	}
+	ContentLoad += LoadDelta;
+
+	if (ParentList) ParentList->ApplyNestedDelta(ItemDefinition, CountDelta, LoadDelta);
+}
+
+void UXIUContainerItem::ResetContentsAggregates()
+{
+	if (ParentList)
+	{
+		for (const TPair<const UXIUItemDefinition*, int32>& Aggregate : AggregateCounts)
+		{
+			ParentList->ApplyNestedDelta(Aggregate.Key, -Aggregate.Value, FXIUInventoryLoad());
+		}
+		if (!ContentLoad.IsZero()) ParentList->ApplyNestedDelta(nullptr, 0, FXIUInventoryLoad() - ContentLoad);
+	}
+	AggregateCounts.Empty();
+	ContentLoad = FXIUInventoryLoad();
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
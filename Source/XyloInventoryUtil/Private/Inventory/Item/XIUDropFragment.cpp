@@ -3,3 +3,8 @@
 
 #include "Inventory/Item/XIUDropFragment.h"
 
+bool UXIUDropFragment::NeedsInstanceCreated() const
+{
+	// data only
+	return IsOnInstanceCreatedImplementedInScript();
+}
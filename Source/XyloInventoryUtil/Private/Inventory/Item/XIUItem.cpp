@@ -3,6 +3,7 @@
 
 #include "Inventory/Item/XIUItem.h"
 
+#include "Inventory/XIUInventoryComponent.h"
 #include "Inventory/XIUInventoryUtilLibrary.h"
 #include "Inventory/Item/XIUItemDefinition.h"
 #include "Net/UnrealNetwork.h"
@@ -11,7 +12,6 @@
 UXIUItem::UXIUItem(const FObjectInitializer& ObjectInitializer)
 	:Super(ObjectInitializer)
 {
-	ItemDefinition = nullptr;
 	bItemInitialized = false;
 }
 
@@ -29,6 +29,26 @@ void UXIUItem::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetime
 	DOREPLIFETIME(ThisClass, Count);
 }
 
+void UXIUItem::BeginDestroy()
+{
+	if (bOwnsState)
+	{
+		delete State;
+		bOwnsState = false;
+	}
+	State = nullptr;
+	
+	Super::BeginDestroy();
+}
+
+void UXIUItem::GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize)
+{
+	Super::GetResourceSizeEx(CumulativeResourceSize);
+
+	// the shared state belongs to the definition
+	if (bOwnsState) CumulativeResourceSize.AddDedicatedSystemMemoryBytes(sizeof(FXIUItemSharedState) + State->ItemName.GetAllocatedSize());
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 /*
@@ -53,7 +73,7 @@ void UXIUItem::OnDestroyed()
 
 FString UXIUItem::GetItemName() const
 {
-	return ItemDefinition->ItemName;
+	return State->ItemName;
 }
 
 bool UXIUItem::IsEmpty() const
@@ -68,13 +88,13 @@ bool UXIUItem::IsFull() const
 
 bool UXIUItem::CanStack(UXIUItem* Item)
 {
-	if (Item->ItemDefinition != ItemDefinition) return false;
+	if (Item->GetItemDefinition() != GetItemDefinition()) return false;
 	return true;
 }
 
 UXIUItem* UXIUItem::Duplicate(UObject* Outer)
 {
-	UXIUItem* Item = UXIUInventoryUtilLibrary::MakeItemFromDefault(Outer, FXIUItemDefault(ItemDefinition, Count));
+	UXIUItem* Item = UXIUInventoryUtilLibrary::MakeItemFromDefault(Outer, FXIUItemDefault(GetItemDefinition(), Count));
 	return Item;
 }
 
@@ -116,6 +136,7 @@ void UXIUItem::InitializingItem()
 	bItemInitialized = true;
 	
 	OnItemInitialized();
+	if (OwnerList) OwnerList->OnItemInitialized(this);
 	ItemInitializedDelegate.Broadcast(this);
 }
 
@@ -139,16 +160,35 @@ void UXIUItem::SetItemDefinition(UXIUItemDefinition* InItemDefinition)
 	checkf(!bItemInitialized, TEXT("Cannot reassign an item definition"))
 	checkf(InItemDefinition, TEXT("Item definition must be valid"))
 
-	ItemDefinition = InItemDefinition;
-	for (UXIUItemFragment* Fragment : ItemDefinition->Fragments)
+	State = InItemDefinition->GetSharedState();
+	if (!State->bCallsFragments) return;
+	
+	for (UXIUItemFragment* Fragment : InItemDefinition->Fragments)
 	{
-		if (Fragment != nullptr)
+		if (Fragment != nullptr && Fragment->NeedsInstanceCreated())
 		{
 			Fragment->OnInstanceCreated(this);
 		}
 	}
 }
 
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Shared State */
+
+FXIUItemSharedState& UXIUItem::GetMutableState()
+{
+	checkf(State, TEXT("Item must have a definition before writing its state"))
+	
+	if (!bOwnsState)
+	{
+		State = new FXIUItemSharedState(*State);
+		bOwnsState = true;
+	}
+	return *const_cast<FXIUItemSharedState*>(State);
+}
+
 /*--------------------------------------------------------------------------------------------------------------------*/
 	
 /*--------------------------------------------------------------------------------------------------------------------*/
@@ -156,7 +196,7 @@ void UXIUItem::SetItemDefinition(UXIUItemDefinition* InItemDefinition)
 
 int32 UXIUItem::GetMaxCount() const
 {
-	return ItemDefinition->MaxCount;
+	return State->MaxCount;
 }
 
 int32 UXIUItem::GetCount() const
@@ -167,8 +207,8 @@ int32 UXIUItem::GetCount() const
 void UXIUItem::SetCount(int32 NewCount)
 {
 	const int32 OldCount = Count;
+	if (OwnerList) OwnerList->WakeNetDormancy();
 	Count = FMath::Clamp(NewCount, 0, GetMaxCount());
-	LastCount = OldCount; // TODO: Remove
 
 	OnRep_Count(OldCount);
 	//UE_LOG(LogTemp, Warning, TEXT("Set Count %i (requested %i. MaxCount %i)"), Count, NewCount, GetMaxCount())
@@ -187,9 +227,22 @@ void UXIUItem::OnRep_Count(int32 OldCount)
 	// checking OldCount != -1 allow to block execution if it is the first count replication
 	if (bItemInitialized && OldCount != -1) 
 	{
-		if (Count != OldCount) ItemCountChangedDelegate.Broadcast(FXIUItemCountChangeMessage(this, OldCount));
+		if (Count != OldCount)
+		{
+			if (OwnerList) OwnerList->OnItemCountChanged(this, OldCount);
+			ItemCountChangedDelegate.Broadcast(FXIUItemCountChangeMessage(this, OldCount));
+		}
 	}
 }
 
 /*--------------------------------------------------------------------------------------------------------------------*/
-	
\ No newline at end of file
+	
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Snapshot */
+
+void UXIUItem::SerializeSnapshotData(FArchive& Ar)
+{
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
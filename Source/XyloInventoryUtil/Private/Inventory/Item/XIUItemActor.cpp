@@ -5,6 +5,7 @@
 
 #include "Inventory/XIUInventoryComponent.h"
 #include "Inventory/XIUInventoryUtilLibrary.h"
+#include "Inventory/XIUNetDormancyComponent.h"
 #include "Net/UnrealNetwork.h"
 
 AXIUItemActor::AXIUItemActor(const FObjectInitializer& ObjectInitializer)
@@ -14,6 +15,8 @@ AXIUItemActor::AXIUItemActor(const FObjectInitializer& ObjectInitializer)
 	PrimaryActorTick.bCanEverTick = false;
 	bReplicateUsingRegisteredSubObjectList = true;
 	Item = nullptr;
+
+	NetDormancyComponent = CreateDefaultSubobject<UXIUNetDormancyComponent>(TEXT("NetDormancyComponent"));
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -47,6 +50,8 @@ void AXIUItemActor::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLif
 
 void AXIUItemActor::SetItem_Implementation(UXIUItem* NewItem, int32 Count)
 {
+	NetDormancyComponent->Wake();
+	
 	UXIUItem* OldItem = Item;
 	Item = UXIUInventoryUtilLibrary::DuplicateItem(this, NewItem);
 	if (Item) Item->SetCount(Count);
@@ -65,6 +70,7 @@ bool AXIUItemActor::TryPickUp_Implementation(UXIUInventoryComponent* OtherInvent
 	
 	if (UXIUItem* GotItem = Execute_GetItem(this))
 	{
+		NetDormancyComponent->Wake();
 		OtherInventory->AddItem(GotItem);
 
 		// no item count left
@@ -88,6 +94,8 @@ bool AXIUItemActor::TryPickUp_Implementation(UXIUInventoryComponent* OtherInvent
 
 void AXIUItemActor::SetItemWithDefault(FXIUItemDefault NewItemDefault)
 {
+	NetDormancyComponent->Wake();
+	
 	Item = UXIUInventoryUtilLibrary::MakeItemFromDefault(this, NewItemDefault);
 	OnRep_Item(nullptr);
 }
@@ -121,6 +129,7 @@ bool AXIUItemActor::TryPickUpInSlot(UXIUInventoryComponent* OtherInventory, cons
 	
 	if (UXIUItem* GotItem = Execute_GetItem(this))
 	{
+		NetDormancyComponent->Wake();
 		if (OtherInventory->SetItemAtSlot(SlotIndex, GotItem))
 		{
 			// item got fully picked up
@@ -135,4 +144,4 @@ bool AXIUItemActor::TryPickUpInSlot(UXIUInventoryComponent* OtherInventory, cons
 	// no item
 	Destroy();
 	return false;
-}
\ No newline at end of file
+}
@@ -7,12 +7,39 @@ void UXIUItemFragment::OnInstanceCreated_Implementation(UXIUItem* Item) const
 {
 }
 
+bool UXIUItemFragment::NeedsInstanceCreated() const
+{
+	if (IsOnInstanceCreatedImplementedInScript()) return true;
+
+	// only fragments with no native class between them and us are known to keep the empty implementation
+	for (const UClass* Class = GetClass(); Class; Class = Class->GetSuperClass())
+	{
+		if (Class->HasAnyClassFlags(CLASS_Native)) return Class != UXIUItemFragment::StaticClass();
+	}
+	return false;
+}
+
+bool UXIUItemFragment::IsOnInstanceCreatedImplementedInScript() const
+{
+	return GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(UXIUItemFragment, OnInstanceCreated));
+}
+
 UXIUItemDefinition::UXIUItemDefinition(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
 {
 	MaxCount = 1;
 }
 
+#if WITH_EDITOR
+void UXIUItemDefinition::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	// updated in place, so the items alive see the new values too (as they did when reading the definition)
+	if (SharedState) UpdateSharedState();
+}
+#endif
+
 const UXIUItemFragment* UXIUItemDefinition::FindFragmentByClass(const TSubclassOf<UXIUItemFragment> FragmentClass) const
 {
 	if (FragmentClass != nullptr)
@@ -28,3 +55,29 @@ const UXIUItemFragment* UXIUItemDefinition::FindFragmentByClass(const TSubclassO
 
 	return nullptr;
 }
+
+const FXIUItemSharedState* UXIUItemDefinition::GetSharedState()
+{
+	if (!SharedState)
+	{
+		SharedState = MakeUnique<FXIUItemSharedState>();
+		UpdateSharedState();
+	}
+	return SharedState.Get();
+}
+
+void UXIUItemDefinition::UpdateSharedState()
+{
+	SharedState->ItemDefinition = this;
+	SharedState->ItemName = ItemName;
+	SharedState->MaxCount = MaxCount;
+	SharedState->bCallsFragments = false;
+	for (const UXIUItemFragment* Fragment : Fragments)
+	{
+		if (Fragment && Fragment->NeedsInstanceCreated())
+		{
+			SharedState->bCallsFragments = true;
+			break;
+		}
+	}
+}
@@ -5,6 +5,7 @@
 
 #include "Inventory/XIUInventoryComponent.h"
 #include "Inventory/XIUInventoryUtilLibrary.h"
+#include "Inventory/XIUNetDormancyComponent.h"
 
 
 AXIUInventoryActor::AXIUInventoryActor()
@@ -13,6 +14,7 @@ AXIUInventoryActor::AXIUInventoryActor()
 	PrimaryActorTick.bCanEverTick = false;
 	
 	InventoryComponent = CreateDefaultSubobject<UXIUInventoryComponent>(TEXT("InventoryComponent"));
+	NetDormancyComponent = CreateDefaultSubobject<UXIUNetDormancyComponent>(TEXT("NetDormancyComponent"));
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -46,7 +48,7 @@ void AXIUInventoryActor::SetItem_Implementation(UXIUItem* InItem, int32 Count)
 
 UXIUItem* AXIUInventoryActor::GetItem_Implementation()
 {
-	if (!InventoryComponent) return nullptr;
+	if (!InventoryComponent || InventoryComponent->IsInventoryEmpty()) return nullptr;
 	return InventoryComponent->GetFirstItem();
 }
 
@@ -73,7 +75,7 @@ void AXIUInventoryActor::OnInventoryInitialized()
 	bInventoryInitialized = true;
 	BP_OnInventoryInitialized();
 
-	if (bDestroyOnEmpty && Execute_GetItem(this) == nullptr) Destroy();
+	if (bDestroyOnEmpty && InventoryComponent && InventoryComponent->IsInventoryEmpty()) Destroy();
 }
 
 void AXIUInventoryActor::OnInventoryChanged(const FXIUInventorySlotChangeMessage& Change)
@@ -82,7 +84,7 @@ void AXIUInventoryActor::OnInventoryChanged(const FXIUInventorySlotChangeMessage
 	
 	if (bInventoryInitialized)
 	{
-		if (bDestroyOnEmpty && Execute_GetItem(this) == nullptr) Destroy();
+		if (bDestroyOnEmpty && InventoryComponent && InventoryComponent->IsInventoryEmpty()) Destroy();
 	}
 }
 
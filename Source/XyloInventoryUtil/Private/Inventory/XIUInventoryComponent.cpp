@@ -3,11 +3,98 @@
 
 #include "Inventory/XIUInventoryComponent.h"
 
+#include "Async/Async.h"
+#include "Inventory/XIULootTable.h"
+#include "Inventory/XIUInventoryJournal.h"
+#include "Inventory/XIUInventoryPageStore.h"
+#include "Inventory/XIUInventoryTrace.h"
 #include "Inventory/XIUInventoryUtilLibrary.h"
+#include "Inventory/XIUInventoryWorldSubsystem.h"
+#include "Inventory/XIUNetDormancyComponent.h"
+#include "Inventory/Item/XIUCapacityFragment.h"
+#include "Inventory/Item/XIUContainerItem.h"
 #include "Inventory/Item/XIUDropFragment.h"
 #include "Inventory/Item/XIUItemActor.h"
 #include "Inventory/Item/XIUItemDefinition.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
 #include "Net/UnrealNetwork.h"
+#include "Serialization/BitWriter.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "TimerManager.h"
+#include "UObject/GCObject.h"
+#include "UObject/StrongObjectPtr.h"
+
+
+namespace XIUInventorySlotSettings
+{
+	/** Never freed, since any slot might point to them. Interned settings are not UPROPERTYs, so their filter classes
+	 * are kept alive from here */
+	class FInterned : public FGCObject
+	{
+	public:
+		TArray<TUniquePtr<FXIUInventorySlotSettings>> Settings;
+		TArray<TObjectPtr<UClass>> Filters;
+
+		virtual void AddReferencedObjects(FReferenceCollector& Collector) override
+		{
+			Collector.AddReferencedObjects(Filters);
+		}
+		virtual FString GetReferencerName() const override
+		{
+			return TEXT("XIUInventorySlotSettings::FInterned");
+		}
+	};
+	
+	static FInterned& GetInterned()
+	{
+		static FInterned Interned;
+		return Interned;
+	}
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/*--------------------------------------------------------------------------------------------------------------------*/
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * FXIUInventorySlotSettings
+ */
+
+
+const FXIUInventorySlotSettings& FXIUInventorySlotSettings::GetDefault()
+{
+	static const FXIUInventorySlotSettings Default;
+	return Default;
+}
+
+const FXIUInventorySlotSettings* FXIUInventorySlotSettings::Intern(const FXIUInventorySlotSettings& Settings)
+{
+	check(IsInGameThread());
+	if (Settings.IsDefault()) return nullptr;
+
+	// games only use a handful of distinct settings, so a linear search is all we need
+	XIUInventorySlotSettings::FInterned& Interned = XIUInventorySlotSettings::GetInterned();
+	for (const TUniquePtr<FXIUInventorySlotSettings>& InternedSettings : Interned.Settings)
+	{
+		if (*InternedSettings == Settings) return InternedSettings.Get();
+	}
+	if (Settings.Filter) Interned.Filters.AddUnique(Settings.Filter.Get());
+	return Interned.Settings.Add_GetRef(MakeUnique<FXIUInventorySlotSettings>(Settings)).Get();
+}
+
+SIZE_T FXIUInventorySlotSettings::GetInternedAllocatedSize()
+{
+	const XIUInventorySlotSettings::FInterned& Interned = XIUInventorySlotSettings::GetInterned();
+	SIZE_T Size = Interned.Settings.GetAllocatedSize() + Interned.Filters.GetAllocatedSize();
+	for (const TUniquePtr<FXIUInventorySlotSettings>& InternedSettings : Interned.Settings)
+	{
+		Size += sizeof(FXIUInventorySlotSettings) + (InternedSettings->RequiredTags.Num() + InternedSettings->BlockedTags.Num()) * sizeof(FGameplayTag);
+	}
+	return Size;
+}
 
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -44,7 +131,7 @@ bool FXIUInventorySlot::Clear(UXIUItem*& OldItem)
 
 bool FXIUInventorySlot::SetItem(UXIUItem* NewItem, UXIUItem*& OldItem)
 {
-	if (bLocked) return false;
+	if (IsLocked()) return false;
 	
 	if (MatchesFilter(NewItem))
 	{
@@ -80,29 +167,24 @@ int32 FXIUInventorySlot::GetItemCountSafe() const
 /*--------------------------------------------------------------------------------------------------------------------*/
 /* Filter */
 
-void FXIUInventorySlot::SetFilter(const TSubclassOf<UXIUItem> NewFilter)
-{
-	Filter = NewFilter;
-}
-
 bool FXIUInventorySlot::MatchesFilter(const UXIUItem* TestItem) const
 {
-	return !Filter || !TestItem || (TestItem->IsA(Filter));
+	if (!TestItem) return true;
+	const TSubclassOf<UXIUItem> Filter = GetFilter();
+	return (!Filter || TestItem->IsA(Filter)) && MatchesTags(TestItem->GetItemDefinition());
 }
 
 bool FXIUInventorySlot::MatchesFilterByClass(const TSubclassOf<UXIUItem> TestItemClass) const
 {
+	const TSubclassOf<UXIUItem> Filter = GetFilter();
 	return !Filter || TestItemClass && (TestItemClass->IsChildOf(Filter));
 }
 
-/*--------------------------------------------------------------------------------------------------------------------*/
-	
-/*--------------------------------------------------------------------------------------------------------------------*/
-/* Locked */
-
-void FXIUInventorySlot::SetLocked(bool NewLock)
+bool FXIUInventorySlot::MatchesTags(const UXIUItemDefinition* TestItemDefinition) const
 {
-	bLocked = NewLock;
+	if (!HasTagFilter()) return true;
+	const FGameplayTagContainer& ItemTags = TestItemDefinition ? TestItemDefinition->ItemTags : FGameplayTagContainer::EmptyContainer;
+	return ItemTags.HasAll(GetRequiredTags()) && !ItemTags.HasAny(GetBlockedTags());
 }
 
 /*--------------------------------------------------------------------------------------------------------------------*/
@@ -118,14 +200,44 @@ bool FXIUInventorySlot::CanInsertItem(UXIUItem* TestItem) const
 	return false;
 }
 
-void FXIUInventorySlot::ApplySettings(const FXIUInventorySlotSettings& SlotSettings)
-{
-	Filter = SlotSettings.Filter;
-	bLocked = SlotSettings.bLocked;
-}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
 
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /*--------------------------------------------------------------------------------------------------------------------*/
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * FXIUInventoryLoad
+ */
+
+
+bool FXIUInventoryLoad::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	// loads are never negative, and usually small, so packing them saves most of the 16 bytes
+	uint32 PackedWeight = static_cast<uint32>(FMath::Clamp<int64>(Weight, 0, MAX_uint32));
+	uint32 PackedVolume = static_cast<uint32>(FMath::Clamp<int64>(Volume, 0, MAX_uint32));
+	Ar.SerializeIntPacked(PackedWeight);
+	Ar.SerializeIntPacked(PackedVolume);
+	if (Ar.IsLoading())
+	{
+		Weight = PackedWeight;
+		Volume = PackedVolume;
+	}
+	bOutSuccess = !Ar.IsError();
+	return true;
+}
 
+bool FXIUInventoryCapacity::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	bool bCurrentSuccess = true;
+	bool bMaxSuccess = true;
+	CurrentLoad.NetSerialize(Ar, Map, bCurrentSuccess);
+	MaxLoad.NetSerialize(Ar, Map, bMaxSuccess);
+	bOutSuccess = bCurrentSuccess && bMaxSuccess;
+	return true;
+}
 
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -140,8 +252,25 @@ void FXIUInventorySlot::ApplySettings(const FXIUInventorySlotSettings& SlotSetti
 /*--------------------------------------------------------------------------------------------------------------------*/
 /* FFastArraySerializer contract */
 
+bool FXIUInventoryList::NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+{
+	const int64 StartBits = DeltaParms.Writer ? DeltaParms.Writer->GetNumBits() : 0;
+	const bool bSuccess = FFastArraySerializer::FastArrayDeltaSerialize<FXIUInventorySlot, FXIUInventoryList>(Entries, DeltaParms, *this);
+	if (DeltaParms.Writer)
+	{
+		const int64 Bytes = (DeltaParms.Writer->GetNumBits() - StartBits + 7) / 8;
+		RecordReplicatedBytes(Bytes);
+		if (Bytes > 0) XIU_INVENTORY_TRACE_REPLICATION(GetTraceOwner(), Write, 0, static_cast<uint32>(Bytes));
+	}
+	return bSuccess;
+}
+
 void FXIUInventoryList::PreReplicatedRemove(const TArrayView<int32>& RemovedIndices, int32 FinalSize)
 {
+	XIU_INVENTORY_TRACE_OP(Replication);
+	XIU_INVENTORY_TRACE_REPLICATION(GetTraceOwner(), PreRemove, RemovedIndices.Num(), 0);
+	SlotLayoutVersion++;
+	if (!OwnerComponent) return; // contents of a container not yet in an inventory (caught up when attached)
 	for (int32 Index : RemovedIndices)
 	{
 		FXIUInventorySlot& Slot = Entries[Index];
@@ -156,9 +285,14 @@ void FXIUInventoryList::PreReplicatedRemove(const TArrayView<int32>& RemovedIndi
 
 void FXIUInventoryList::PostReplicatedAdd(const TArrayView<int32>& AddedIndices, int32 FinalSize)
 {
+	XIU_INVENTORY_TRACE_OP(Replication);
+	XIU_INVENTORY_TRACE_REPLICATION(GetTraceOwner(), PostAdd, AddedIndices.Num(), 0);
+	SlotLayoutVersion++;
+	if (!OwnerComponent) return; // contents of a container not yet in an inventory (caught up when attached)
 	for (int32 Index : AddedIndices)
 	{
 		FXIUInventorySlot& Slot = Entries[Index];
+		if (ResolveSlotSettings(Slot)) InvalidateFilterGroups();
 		
 		int32 NewCount = Slot.GetItemCountSafe();
 		RegisterSlotChange(Slot, 0, NewCount, true);
@@ -170,10 +304,15 @@ void FXIUInventoryList::PostReplicatedAdd(const TArrayView<int32>& AddedIndices,
 
 void FXIUInventoryList::PostReplicatedChange(const TArrayView<int32>& ChangedIndices, int32 FinalSize)
 {
+	XIU_INVENTORY_TRACE_OP(Replication);
+	XIU_INVENTORY_TRACE_REPLICATION(GetTraceOwner(), PostChange, ChangedIndices.Num(), 0);
+	if (!OwnerComponent) return; // contents of a container not yet in an inventory (caught up when attached)
 	for (int32 Index : ChangedIndices)
 	{
 		FXIUInventorySlot& Slot = Entries[Index];
 		check(Slot.LastObservedCount != INDEX_NONE);
+		ResolveSlotSettings(Slot);
+		if (!EntryFilterGroups.IsValidIndex(Index) || !FilterGroups[EntryFilterGroups[Index]].HasSameFilter(Slot)) InvalidateFilterGroups();
 
 		int32 NewCount = Slot.GetItemCountSafe();
 		bool bItemChanged = Slot.LastObservedItem != Slot.GetItem() || (Slot.LastObservedCount != 0 && NewCount == 0);
@@ -193,286 +332,2140 @@ void FXIUInventoryList::PostReplicatedChange(const TArrayView<int32>& ChangedInd
 
 void FXIUInventoryList::BroadcastChangeMessage(const FXIUInventorySlot& Entry, const int32 OldCount, const int32 NewCount, UXIUItem* OldItem) const
 {
+	// restored snapshots only broadcast the initialized event
+	if (OwnerComponent && OwnerComponent->IsRestoringSnapshot()) return;
+	
 	FXIUInventorySlotChangeMessage Message;
 	Message.InventoryOwner = OwnerComponent;
+	Message.Container = OwnerContainer;
 	Message.Index = Entry.Index;
 	Message.bItemChanged = Entry.Item != OldItem || NewCount == 0;
 	Message.Item = Entry.GetItemSafe();
 	Message.NewCount = NewCount;
 	Message.Delta = NewCount - OldCount;
 	Message.OldItem = OldItem;
-	Message.Filter = Entry.Filter;
-	Message.bLocked = Entry.bLocked;
+	Message.Filter = Entry.GetFilter();
+	Message.bLocked = Entry.IsLocked();
 
+	if (ChangeBatchDepth > 0)
+	{
+		PendingChangeMessages.Add(Message);
+		return;
+	}
 	if (OwnerComponent) OwnerComponent->BroadcastInventoryChanged(Message);
 }
 
-bool FXIUInventoryList::CanManipulateInventory() const
+void FXIUInventoryList::BeginChangeBatch()
 {
-	if (!OwnerComponent) return false;
-	AActor* OwningActor = OwnerComponent->GetOwner();
-	if (!OwningActor->HasAuthority()) return false;
-	return true;
+	ChangeBatchDepth++;
 }
 
-/*--------------------------------------------------------------------------------------------------------------------*/
-/* Slots Management */
-
-void FXIUInventoryList::InitInventory(int32 Size)
+void FXIUInventoryList::EndChangeBatch()
 {
-	check(CanManipulateInventory());
-	
-	Entries.Empty();
-	Entries.Reserve(Size);
-	for (int32 i = 0; i < Size ; i++)
+	check(ChangeBatchDepth > 0);
+	if (--ChangeBatchDepth > 0) return;
+
+	// listeners might start a new batch, so we take the messages out first
+	TArray<FXIUInventorySlotChangeMessage> Messages = MoveTemp(PendingChangeMessages);
+	PendingChangeMessages.Reset();
+	if (!OwnerComponent) return;
+	for (const FXIUInventorySlotChangeMessage& Message : Messages)
 	{
-		FXIUInventorySlot& NewSlot = Entries.AddDefaulted_GetRef();
-		NewSlot.Index = i;
-		MarkItemDirty(NewSlot);
-		RegisterSlotChange(NewSlot, 0, 0, true);
+		OwnerComponent->BroadcastInventoryChanged(Message);
 	}
 }
 
-void FXIUInventoryList::AddSlot(const FXIUInventorySlotSettings& SlotSettings)
+bool FXIUInventoryList::CanManipulateInventory() const
 {
-	check(CanManipulateInventory());
-
-	FXIUInventorySlot& NewSlot = Entries.AddDefaulted_GetRef();
-	NewSlot.Index = Entries.Num() - 1; // we can never remove slots, so indexes are for sure progressive
-	NewSlot.ApplySettings(SlotSettings);
-	MarkItemDirty(NewSlot);
-	RegisterSlotChange(NewSlot, 0, 0, true);
+	if (!OwnerComponent) return false;
+	AActor* OwningActor = OwnerComponent->GetOwner();
+	if (!OwningActor->HasAuthority()) return false;
+	return true;
 }
 
-int32 FXIUInventoryList::AddItemDefault(FXIUItemDefault ItemDefault, TArray<UXIUItem*>& AddedItems)
+const FXIUInventorySlot* FXIUInventoryList::FindSlot(const int32 SlotIndex) const
 {
-	check(CanManipulateInventory());
-	checkf(ItemDefault.ItemDefinition && ItemDefault.ItemDefinition->ItemClass, TEXT("Cannot add item of not specified class"))
+	if (SlotIndex < 0) return nullptr;
 	
-	int32 RemainingCount = ItemDefault.Count;
-	if (RemainingCount <= 0) return RemainingCount;
-
-	// try to add count to existing items
-	for (FXIUInventorySlot& Slot : Entries)
+	// slots are stored in index order on server (and usually on client too), unless storage is paged
+	if (Entries.IsValidIndex(SlotIndex) && Entries[SlotIndex].Index == SlotIndex)
 	{
-		if (!Slot.IsEmpty() && Slot.GetItem()->GetItemDefinition() == ItemDefault.ItemDefinition)
-		{
-			RemainingCount -= Slot.GetItem()->ModifyCount(RemainingCount);
-			
-			if (RemainingCount <= 0)
-			{
-				return RemainingCount;
-			}
-		}
+		return &Entries[SlotIndex];
 	}
-	
-	
-	// still count to add
-	for (FXIUInventorySlot& Slot : Entries)
+
+	// the cache is rebuilt when slots got added or removed, or when an entry moved without us noticing
+	const int32* EntryIndex = SlotToEntryCache.Find(SlotIndex);
+	const bool bStaleEntry = EntryIndex && (!Entries.IsValidIndex(*EntryIndex) || Entries[*EntryIndex].Index != SlotIndex);
+	if (CachedSlotLayoutVersion != SlotLayoutVersion || bStaleEntry)
 	{
-		//check if I can add the item
-		if (Slot.IsEmpty() && !Slot.IsLocked() && Slot.MatchesFilterByClass(ItemDefault.ItemDefinition->ItemClass))
+		SlotToEntryCache.Reset();
+		for (int32 i = 0; i < Entries.Num(); i++)
 		{
-			ItemDefault.Count = RemainingCount;
-			if (UXIUItem* NewItem = UXIUInventoryUtilLibrary::MakeItemFromDefault(OwnerComponent->GetOwner(), ItemDefault))
-			{
-				UXIUItem* OldItem;
-				if (Slot.SetItem(NewItem, OldItem))
-				{
-					MarkItemDirty(Slot);
-					RegisterSlotChange(Slot, 0, NewItem->GetCount(), true, OldItem);
-					
-					AddedItems.Add(NewItem);
-					RemainingCount -= NewItem->GetCount();
-					
-					if (RemainingCount <= 0)
-					{
-						return RemainingCount;
-					}
-				}
-			}
+			SlotToEntryCache.Add(Entries[i].Index, i);
 		}
+		CachedSlotLayoutVersion = SlotLayoutVersion;
+		EntryIndex = SlotToEntryCache.Find(SlotIndex);
 	}
-	return RemainingCount;
+	return EntryIndex ? &Entries[*EntryIndex] : nullptr;
 }
 
-int32 FXIUInventoryList::AddItem(UXIUItem* Item, int32 CountOverride, bool bDuplicate, bool bModifyItemCount, UXIUItem*& AddedItem)
+FXIUInventorySlot* FXIUInventoryList::FindSlot(const int32 SlotIndex)
 {
-	check(CanManipulateInventory());
-	checkf(Item, TEXT("Cannot add item invalid item"))
+	return const_cast<FXIUInventorySlot*>(static_cast<const FXIUInventoryList*>(this)->FindSlot(SlotIndex));
+}
 
-	int32 RemainingCount = CountOverride >= 0 ? FMath::Min(Item->GetCount(), CountOverride) : Item->GetCount();
-	if (RemainingCount <= 0) return 0;
+/*--------------------------------------------------------------------------------------------------------------------*/
 
-	// try to add count to existing items
-	for (FXIUInventorySlot& Slot : Entries)
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Filter cache */
+
+void FXIUInventoryList::InvalidateFilterGroups()
+{
+	bFilterGroupsDirty = true;
+}
+
+bool FXIUInventoryList::IsFilterCompatible(const UClass* Filter, const UClass* ItemClass) const
+{
+	if (!Filter) return true;
+	if (!ItemClass) return false;
+
+	const TPair<TObjectKey<UClass>, TObjectKey<UClass>> Key(Filter, ItemClass);
+	if (const bool* bCompatible = FilterCompatibility.Find(Key))
 	{
-		if (!Slot.IsEmpty() && Slot.GetItem()->CanStack(Item))
-		{
-			RemainingCount -= Slot.GetItem()->ModifyCount(RemainingCount);
+		return *bCompatible;
+	}
+	return FilterCompatibility.Add(Key, ItemClass->IsChildOf(Filter));
+}
 
-			// We are done adding, and we do not need to create a new stack
-			if (RemainingCount <= 0)
-			{
-				if (bModifyItemCount) Item->SetCount(0);
-				return RemainingCount;
-			}
-		}
+bool FXIUInventoryList::CanInsertItemInSlot(const FXIUInventorySlot& Slot, UXIUItem* TestItem) const
+{
+	if (Slot.IsLocked()) return false;
+	if (Slot.IsEmpty())
+	{
+		if (!TestItem) return true;
+		
+		UpdateFilterGroups();
+		const int32 EntryIndex = static_cast<int32>(&Slot - Entries.GetData());
+		check(Entries.IsValidIndex(EntryIndex));
+		return MatchesFilterGroup(FilterGroups[EntryFilterGroups[EntryIndex]], TestItem->GetItemDefinition(), TestItem->GetClass());
 	}
+	if (!Slot.GetItem()->IsFull() && Slot.GetItem()->CanStack(TestItem)) return true;
+	return false;
+}
 
-	// still count to add, so we make new item
-	if (bModifyItemCount) Item->SetCount(RemainingCount);
-	if (UXIUItem* NewItem = bDuplicate ? UXIUInventoryUtilLibrary::DuplicateItem(OwnerComponent->GetOwner(), Item) : Item)
+void FXIUInventoryList::MatchFilterGroups(const UXIUItemDefinition* ItemDefinition, const UClass* ItemClass, TArray<bool, TInlineAllocator<8>>& OutGroupMatches) const
+{
+	UpdateFilterGroups();
+	OutGroupMatches.Reset(FilterGroups.Num());
+	for (const FXIUInventoryFilterGroup& Group : FilterGroups)
 	{
-		NewItem->SetCount(RemainingCount);
-		for (FXIUInventorySlot& Slot : Entries)
-		{
-			if (Slot.IsEmpty())
-			{
-				UXIUItem* OldItem;
-				if (Slot.SetItem(NewItem, OldItem))
-				{
-					MarkItemDirty(Slot);
-					RegisterSlotChange(Slot, 0, NewItem->GetCount(), true, OldItem);
-					
-					AddedItem = NewItem;
-					if (bDuplicate && bModifyItemCount) Item->SetCount(0);
-					RemainingCount = 0;
-					break;
-				}
-			}
-		}
+		OutGroupMatches.Add(MatchesFilterGroup(Group, ItemDefinition, ItemClass));
 	}
-	return RemainingCount;
 }
 
-bool FXIUInventoryList::SetItemAtSlot(int32 SlotIndex, UXIUItem* Item, bool bDuplicate, UXIUItem*& AddedItem, UXIUItem*& OldItem)
+bool FXIUInventoryList::CanInsertItem(UXIUItem* TestItem) const
 {
-	check(CanManipulateInventory());
-	checkf(SlotIndex < Entries.Num(), TEXT("The slot at index %i does not exist"), SlotIndex)
+	if (!TestItem) return false;
+	if (OwnerComponent && OwnerComponent->GetCountWithinCapacity(GetUnitLoad(TestItem->GetItemDefinition()), 1) == 0) return false;
 	
-	if (UXIUItem* NewItem = bDuplicate ? UXIUInventoryUtilLibrary::DuplicateItem(OwnerComponent->GetOwner(), Item) : Item)
+	TArray<bool, TInlineAllocator<8>> GroupMatches;
+	MatchFilterGroups(TestItem->GetItemDefinition(), TestItem->GetClass(), GroupMatches);
+	for (int32 EntryIndex = 0; EntryIndex < Entries.Num(); EntryIndex++)
 	{
-		FXIUInventorySlot& Slot = Entries[SlotIndex];
-		if (Slot.SetItem(NewItem, OldItem))
+		const FXIUInventorySlot& Slot = Entries[EntryIndex];
+		if (Slot.IsLocked()) continue;
+		if (Slot.IsEmpty())
+		{
+			if (GroupMatches[EntryFilterGroups[EntryIndex]]) return true;
+		}
+		else if (!Slot.GetItem()->IsFull() && Slot.GetItem()->CanStack(TestItem))
 		{
-			MarkItemDirty(Slot);
-			RegisterSlotChange(Slot, 0, NewItem->GetCount(), true, OldItem);
-			
-			AddedItem = NewItem;
 			return true;
 		}
 	}
-	return false;
+	return HasFreeSlotsOutsideResidentPages();
 }
 
-UXIUItem* FXIUInventoryList::GetItemAtSlot(const int32 SlotIndex)
+bool FXIUInventoryList::SetSlotItem(FXIUInventorySlot& Slot, UXIUItem* NewItem, UXIUItem*& OldItem)
 {
-	for (FXIUInventorySlot& Slot : Entries)
+	if (Slot.IsLocked()) return false;
+	if (NewItem)
 	{
-		if (Slot.GetIndex() == SlotIndex)
-		{
-			return Slot.GetItemSafe();
-		}
+		UpdateFilterGroups();
+		const int32 EntryIndex = static_cast<int32>(&Slot - Entries.GetData());
+		check(Entries.IsValidIndex(EntryIndex));
+		if (!MatchesFilterGroup(FilterGroups[EntryFilterGroups[EntryIndex]], NewItem->GetItemDefinition(), NewItem->GetClass())) return false;
 	}
-	return nullptr;
+
+	WakeNetDormancy();
+	OldItem = Slot.Item;
+	Slot.Item = NewItem;
+	return true;
 }
 
-UXIUItem* FXIUInventoryList::RemoveItemAtSlot(int32 SlotIndex)
+void FXIUInventoryList::UpdateFilterGroups() const
 {
-	check(CanManipulateInventory());
-	checkf(SlotIndex < Entries.Num(), TEXT("The slot at index %i does not exist"), SlotIndex)
+	if (!bFilterGroupsDirty && FilterGroupsLayoutVersion == SlotLayoutVersion) return;
 
-	UXIUItem* OldItem;
-	FXIUInventorySlot& Slot = Entries[SlotIndex];
-	Slot.Clear(OldItem);
+	// inventories usually have few distinct filters, so a linear search is faster than a map
+	FilterGroups.Reset();
+	EntryFilterGroups.Reset(Entries.Num());
+	TArray<FGameplayTag> NewFilterTags;
+	for (const FXIUInventorySlot& Slot : Entries)
+	{
+		int32 GroupIndex = FilterGroups.IndexOfByPredicate([&Slot](const FXIUInventoryFilterGroup& Group) { return Group.HasSameFilter(Slot); });
+		if (GroupIndex == INDEX_NONE)
+		{
+			GroupIndex = FilterGroups.Num();
+			FXIUInventoryFilterGroup& NewGroup = FilterGroups.AddDefaulted_GetRef();
+			NewGroup.Filter = Slot.GetFilter();
+			NewGroup.RequiredTags = Slot.GetRequiredTags();
+			NewGroup.BlockedTags = Slot.GetBlockedTags();
+			for (const FGameplayTag& Tag : NewGroup.RequiredTags) NewFilterTags.AddUnique(Tag);
+			for (const FGameplayTag& Tag : NewGroup.BlockedTags) NewFilterTags.AddUnique(Tag);
+		}
+		EntryFilterGroups.Add(GroupIndex);
+	}
 
-	MarkItemDirty(Slot);
-	RegisterSlotChange(Slot, OldItem ? OldItem->GetCount() : 0, 0, true, OldItem);
+	// masks of definitions are only valid for the set of tags they were computed against
+	if (NewFilterTags != FilterTags)
+	{
+		FilterTags = MoveTemp(NewFilterTags);
+		DefinitionTagMasks.Reset();
+	}
+	bFilterTagsOverflow = FilterTags.Num() > 64;
+	if (!bFilterTagsOverflow)
+	{
+		for (FXIUInventoryFilterGroup& Group : FilterGroups)
+		{
+			for (const FGameplayTag& Tag : Group.RequiredTags) Group.RequiredTagMask |= 1ull << FilterTags.IndexOfByKey(Tag);
+			for (const FGameplayTag& Tag : Group.BlockedTags) Group.BlockedTagMask |= 1ull << FilterTags.IndexOfByKey(Tag);
+		}
+	}
 	
-	return OldItem;
+	FilterGroupsLayoutVersion = SlotLayoutVersion;
+	bFilterGroupsDirty = false;
 }
 
-bool FXIUInventoryList::GetItemsByClass(const TSubclassOf<UXIUItem> ItemClass, TArray<UXIUItem*>& FoundItems)
+bool FXIUInventoryList::MatchesFilterGroup(const FXIUInventoryFilterGroup& Group, const UXIUItemDefinition* ItemDefinition, const UClass* ItemClass) const
 {
-	for (FXIUInventorySlot& Slot : Entries)
+	if (!IsFilterCompatible(Group.Filter, ItemClass)) return false;
+	if (!Group.HasTagFilter()) return true;
+
+	if (bFilterTagsOverflow)
 	{
-		if (!Slot.IsEmpty() && Slot.GetItem()->IsA(ItemClass))
-		{
-			FoundItems.Add(Slot.GetItem());
-		}
+		const FGameplayTagContainer& ItemTags = ItemDefinition ? ItemDefinition->ItemTags : FGameplayTagContainer::EmptyContainer;
+		return ItemTags.HasAll(Group.RequiredTags) && !ItemTags.HasAny(Group.BlockedTags);
 	}
-	return FoundItems.Num() > 0;
+	const uint64 TagMask = GetDefinitionTagMask(ItemDefinition);
+	return (TagMask & Group.RequiredTagMask) == Group.RequiredTagMask && (TagMask & Group.BlockedTagMask) == 0;
 }
 
-int32 FXIUInventoryList::ConsumeItemByDefinition(const UXIUItemDefinition* ItemDefinition, const int32 Count)
+bool FXIUInventoryList::MatchesGroupFilter(const FXIUInventoryFilterGroup& Group, const UXIUItemDefinition* ItemDefinition, const UClass* ItemClass) const
 {
-	check(CanManipulateInventory());
-	if (!ItemDefinition) return 0;
+	if (!IsFilterCompatible(Group.Filter, ItemClass)) return false;
+	if (!Group.HasTagFilter()) return true;
 	
-	int32 CountLeftToConsume = Count;
-	for (FXIUInventorySlot& Slot : Entries)
+	const FGameplayTagContainer& ItemTags = ItemDefinition ? ItemDefinition->ItemTags : FGameplayTagContainer::EmptyContainer;
+	return ItemTags.HasAll(Group.RequiredTags) && !ItemTags.HasAny(Group.BlockedTags);
+}
+
+uint64 FXIUInventoryList::GetDefinitionTagMask(const UXIUItemDefinition* ItemDefinition) const
+{
+	if (!ItemDefinition) return 0;
+	if (const uint64* TagMask = DefinitionTagMasks.Find(ItemDefinition))
 	{
-		if (!Slot.IsEmpty() && Slot.GetItem()->GetItemDefinition() == ItemDefinition)
-		{
-			CountLeftToConsume -= -Slot.GetItem()->ModifyCount(-CountLeftToConsume); // we are removing count, so the function returns a negative number representing the count removed
-			
-			if (CountLeftToConsume <= 0) break;
-		}
+		return *TagMask;
 	}
-	return Count - CountLeftToConsume; // Consumed items
+
+	uint64 TagMask = 0;
+	for (int32 TagIndex = 0; TagIndex < FilterTags.Num(); TagIndex++)
+	{
+		// HasTag also matches parents, so an item tagged Item.Ammo.Rifle goes in a slot requiring Item.Ammo
+		if (ItemDefinition->ItemTags.HasTag(FilterTags[TagIndex])) TagMask |= 1ull << TagIndex;
+	}
+	return DefinitionTagMasks.Add(ItemDefinition, TagMask);
 }
 
 /*--------------------------------------------------------------------------------------------------------------------*/
+/* Slot settings */
 
-/*--------------------------------------------------------------------------------------------------------------------*/
-/* Items registration */
+void FXIUInventoryList::ApplySlotSettings(FXIUInventorySlot& Slot, const FXIUInventorySlotSettings& Settings)
+{
+	Slot.SettingsIndex = AddToSettingsPalette(Settings);
+	Slot.Settings = FXIUInventorySlotSettings::Intern(Settings);
+}
 
-void FXIUInventoryList::RegisterSlotChange(const FXIUInventorySlot& Slot, const int32 OldCount, const int32 NewCount, const bool bRegisterItemChange, UXIUItem* OldItem)
+void FXIUInventoryList::OnSettingsPaletteReplicated()
 {
-	if (bRegisterItemChange)
+	ResolvedPalette.Reset();
+	TArray<int32> ChangedIndices;
+	for (int32 Index = 0; Index < Entries.Num(); Index++)
 	{
-		// if new item is not initialized, we register it, and we bind the ItemInitialized to receive a change when it
-		// gets initialized.
-		// otherwise if the item is not empty, we register it, and we bind the count changed delegate
-		if (UXIUItem* NewItem = Slot.GetItem())
+		// slots never observed get their settings when they are added
+		if (ResolveSlotSettings(Entries[Index]) && Entries[Index].LastObservedCount != INDEX_NONE) ChangedIndices.Add(Index);
+	}
+	if (ChangedIndices.IsEmpty()) return;
+	
+	InvalidateFilterGroups();
+	PostReplicatedChange(ChangedIndices, Entries.Num());
+}
+
+TArray<FXIUInventorySlotSettings>* FXIUInventoryList::GetSettingsPalette() const
+{
+	if (OwnerContainer) return &OwnerContainer->ContentsSlotSettings;
+	return OwnerComponent ? &OwnerComponent->SlotSettingsPalette : nullptr;
+}
+
+uint16 FXIUInventoryList::AddToSettingsPalette(const FXIUInventorySlotSettings& Settings)
+{
+	TArray<FXIUInventorySlotSettings>* Palette = GetSettingsPalette();
+	if (Settings.IsDefault() || !Palette) return 0;
+
+	int32 PaletteIndex = Palette->IndexOfByKey(Settings);
+	if (PaletteIndex == INDEX_NONE)
+	{
+		if (Palette->Num() >= MAX_uint16)
 		{
-			if (!NewItem->IsItemInitialized())
-			{
-				OwnerComponent->RegisterReplicatedObject(NewItem);
-				OwnerComponent->BindItemInitializedDelegate(NewItem);
-			}
-			else
-			{
-				OwnerComponent->UnBindItemInitializedDelegate(NewItem);
-				if (!NewItem->IsEmpty())
-				{
-					OwnerComponent->RegisterReplicatedObject(NewItem);
-					OwnerComponent->BindItemCountChangedDelegate(NewItem);
-				}
-			}
+			UE_LOG(LogTemp, Error, TEXT("FXIUInventoryList::AddToSettingsPalette -> Too many distinct slot settings, clients will see default settings"))
+			return 0;
 		}
+		PaletteIndex = Palette->Add(Settings);
 	}
+	return PaletteIndex + 1;
+}
 
-	// Broadcast change
-	BroadcastChangeMessage(Slot, OldCount, NewCount, OldItem); 
-
-	if (bRegisterItemChange)
+bool FXIUInventoryList::ResolveSlotSettings(FXIUInventorySlot& Slot)
+{
+	const FXIUInventorySlotSettings* Settings = nullptr;
+	const TArray<FXIUInventorySlotSettings>* Palette = GetSettingsPalette();
+	const int32 PaletteIndex = Slot.SettingsIndex - 1;
+	if (Palette && Palette->IsValidIndex(PaletteIndex))
 	{
-		// if the old item is valid, we unregister it and unbind the ItemCountChanged delegate
-		if (OldItem)
+		while (ResolvedPalette.Num() <= PaletteIndex)
 		{
-			OwnerComponent->UnBindItemCountChangedDelegate(OldItem);
-			OwnerComponent->UnregisterReplicatedObject(OldItem, true);
+			ResolvedPalette.Add(FXIUInventorySlotSettings::Intern((*Palette)[ResolvedPalette.Num()]));
 		}
+		Settings = ResolvedPalette[PaletteIndex];
 	}
+	// otherwise the palette did not replicate yet, so the slot uses default settings until it does
+
+	if (Slot.Settings == Settings) return false;
+	Slot.Settings = Settings;
+	return true;
 }
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Slots Management */
 
+void FXIUInventoryList::InitInventory(int32 Size)
+{
+	XIU_INVENTORY_TRACE_OP(Init);
+	check(CanManipulateInventory());
+	WakeNetDormancy();
+	
+	MarkRemovedSlotsChanged(Size);
+	ResetSlotTracking();
+	if (IsPaged())
+	{
+		// pages get created on first write
+		ResetPages(Size);
+		return;
+	}
+	
+	Entries.Empty();
+	SlotLayoutVersion++;
+	Entries.Reserve(Size);
+	for (int32 i = 0; i < Size ; i++)
+	{
+		FXIUInventorySlot& NewSlot = Entries.AddDefaulted_GetRef();
+		NewSlot.Index = i;
+		MarkItemDirty(NewSlot);
+		RegisterSlotChange(NewSlot, 0, 0, true);
+	}
+}
+
+void FXIUInventoryList::AddSlot(const FXIUInventorySlotSettings& SlotSettings)
+{
+	check(CanManipulateInventory());
+	WakeNetDormancy();
+
+	if (IsPaged())
+	{
+		PagedSlotCount++;
+		Pages.SetNum(FMath::DivideAndRoundUp(PagedSlotCount, SlotsPerPage));
+		
+		// a slot with default settings does not need its page until something is written to it
+		if (!SlotSettings.IsDefault())
+		{
+			if (FXIUInventorySlot* NewSlot = FindOrMaterializeSlot(PagedSlotCount - 1))
+			{
+				ApplySlotSettings(*NewSlot, SlotSettings);
+				InvalidateFilterGroups();
+				MarkItemDirty(*NewSlot);
+				RegisterSlotChange(*NewSlot, 0, 0, true);
+			}
+		}
+		return;
+	}
+
+	SlotLayoutVersion++;
+	FXIUInventorySlot& NewSlot = Entries.AddDefaulted_GetRef();
+	NewSlot.Index = Entries.Num() - 1; // we can never remove slots, so indexes are for sure progressive
+	ApplySlotSettings(NewSlot, SlotSettings);
+	InvalidateFilterGroups();
+	MarkItemDirty(NewSlot);
+	RegisterSlotChange(NewSlot, 0, 0, true);
+}
+
+int32 FXIUInventoryList::AddItemDefault(FXIUItemDefault ItemDefault, TArray<UXIUItem*>& AddedItems)
+{
+	XIU_INVENTORY_TRACE_OP(Add);
+	check(CanManipulateInventory());
+	checkf(ItemDefault.ItemDefinition && ItemDefault.ItemDefinition->ItemClass, TEXT("Cannot add item of not specified class"))
+	
+	int32 RemainingCount = ItemDefault.Count;
+	if (RemainingCount <= 0) return RemainingCount;
+
+	// count exceeding weight or volume limits is never added
+	const int32 RejectedCount = RemainingCount - OwnerComponent->GetCountWithinCapacity(GetUnitLoad(ItemDefault.ItemDefinition), RemainingCount);
+	RemainingCount -= RejectedCount;
+	if (RemainingCount <= 0) return RejectedCount;
+
+	// stored pages holding this item need to be in memory to top up their stacks
+	PageInDefinition(ItemDefault.ItemDefinition);
+
+	// with paged storage, new pages get created after the resident ones are full
+	FXIUInventoryChangeBatchScope ChangeBatch(*this);
+	FXIUInventoryPlacementPlan Plan;
+	do
+	{
+		PlanPlacement(ItemDefault.ItemDefinition, nullptr, RemainingCount, Plan);
+		RemainingCount -= CommitPlacement(Plan, [this, &ItemDefault](const int32 StackCount, const int32 CommittedCount)
+		{
+			return UXIUInventoryUtilLibrary::MakeItemFromDefault(OwnerComponent->GetOwner(), FXIUItemDefault(ItemDefault.ItemDefinition, StackCount));
+		}, [](UXIUItem* Stack)
+		{
+			// nothing references it, so it just gets garbage collected
+		}, AddedItems);
+	}
+	while (RemainingCount > 0 && MaterializePageWithFreeSlots());
+	return RemainingCount + RejectedCount;
+}
+
+int32 FXIUInventoryList::AddItem(UXIUItem* Item, int32 CountOverride, bool bDuplicate, bool bModifyItemCount, UXIUItem*& AddedItem)
+{
+	XIU_INVENTORY_TRACE_OP(Add);
+	check(CanManipulateInventory());
+	checkf(Item, TEXT("Cannot add item invalid item"))
+
+	int32 RemainingCount = CountOverride >= 0 ? FMath::Min(Item->GetCount(), CountOverride) : Item->GetCount();
+	if (RemainingCount <= 0) return 0;
+
+	// count exceeding weight or volume limits is never added
+	const int32 RejectedCount = RemainingCount - OwnerComponent->GetCountWithinCapacity(GetUnitLoad(Item->GetItemDefinition()), RemainingCount);
+	RemainingCount -= RejectedCount;
+	if (RemainingCount <= 0) return RejectedCount;
+
+	// stored pages holding this item need to be in memory to top up their stacks
+	PageInDefinition(Item->GetItemDefinition());
+
+	// new stacks are copies of Item, made before its count changes. Without bDuplicate, Item itself becomes the
+	// stack taking the last of its count, so it never has to keep a remainder (the count not added stays on Item).
+	// Items of another actor are always copied: clients received them through its channel, not the one of our owner
+	const bool bMoveItem = !bDuplicate && Item->GetOuter() == OwnerComponent->GetOwner();
+	const int32 ItemCount = Item->GetCount();
+	bool bItemPlaced = false;
+	int32 PlacedCount = 0;
+	{
+		FXIUInventoryChangeBatchScope ChangeBatch(*this);
+		FXIUInventoryPlacementPlan Plan;
+		TArray<UXIUItem*> NewStacks;
+		do
+		{
+			PlanPlacement(Item->GetItemDefinition(), Item, RemainingCount, Plan);
+			const int32 Placed = CommitPlacement(Plan, [this, Item, ItemCount, bMoveItem, PlacedCount, &bItemPlaced](const int32 StackCount, const int32 CommittedCount)
+			{
+				UXIUItem* NewItem;
+				if (bMoveItem && PlacedCount + CommittedCount + StackCount == ItemCount)
+				{
+					NewItem = Item;
+					bItemPlaced = true;
+				}
+				else
+				{
+					NewItem = UXIUInventoryUtilLibrary::DuplicateItem(OwnerComponent->GetOwner(), Item);
+				}
+				if (NewItem) NewItem->SetCount(StackCount);
+				return NewItem;
+			}, [Item, ItemCount, &bItemPlaced](UXIUItem* Stack)
+			{
+				// copies nobody references get garbage collected, Item goes back to how it was given to us
+				if (Stack != Item) return;
+				Item->SetCount(ItemCount);
+				bItemPlaced = false;
+			}, NewStacks);
+			RemainingCount -= Placed;
+			PlacedCount += Placed;
+		}
+		while (RemainingCount > 0 && MaterializePageWithFreeSlots());
+		if (NewStacks.Num() > 0) AddedItem = NewStacks[0];
+	}
+
+	if (bModifyItemCount && !bItemPlaced) Item->SetCount(Item->GetCount() - PlacedCount);
+	return RemainingCount + RejectedCount;
+}
+
+void FXIUInventoryList::PlanPlacement(const UXIUItemDefinition* ItemDefinition, UXIUItem* Item, const int32 Count, FXIUInventoryPlacementPlan& OutPlan) const
+{
+	OutPlan.Reset();
+	OutPlan.Leftover = Count;
+	if (!ItemDefinition || Count <= 0) return;
+
+	const int32 MaxCount = FMath::Max(Item ? Item->GetMaxCount() : ItemDefinition->MaxCount, 1);
+	TArray<bool, TInlineAllocator<8>> GroupMatches;
+	MatchFilterGroups(ItemDefinition, Item ? Item->GetClass() : ItemDefinition->ItemClass.Get(), GroupMatches);
+
+	// existing stacks anywhere in the inventory come before any empty slot, so empty slots are only remembered
+	TArray<int32, TInlineAllocator<16>> EmptyEntries;
+	int32 EmptyCapacityNeeded = Count;
+	for (int32 EntryIndex = 0; EntryIndex < Entries.Num() && OutPlan.Leftover > 0; EntryIndex++)
+	{
+		const FXIUInventorySlot& Slot = Entries[EntryIndex];
+		if (Slot.IsLocked()) continue;
+
+		if (UXIUItem* SlotItem = Slot.GetItemSafe())
+		{
+			const int32 Space = CanStackOnSlotItem(SlotItem, ItemDefinition, Item) ? SlotItem->GetMaxCount() - SlotItem->GetCount() : 0;
+			if (Space <= 0) continue;
+			
+			const int32 TopUp = FMath::Min(Space, OutPlan.Leftover);
+			OutPlan.TopUps.Add({ EntryIndex, TopUp });
+			OutPlan.Leftover -= TopUp;
+		}
+		else if (EmptyCapacityNeeded > 0 && GroupMatches[GetEntryFilterGroup(EntryIndex)])
+		{
+			// no need to remember more empty slots than the whole count could fill
+			EmptyEntries.Add(EntryIndex);
+			EmptyCapacityNeeded -= MaxCount;
+		}
+	}
+
+	for (const int32 EntryIndex : EmptyEntries)
+	{
+		if (OutPlan.Leftover <= 0) break;
+		const int32 StackCount = FMath::Min(MaxCount, OutPlan.Leftover);
+		OutPlan.NewStacks.Add({ EntryIndex, StackCount });
+		OutPlan.Leftover -= StackCount;
+	}
+}
+
+bool FXIUInventoryList::CanStackOnSlotItem(UXIUItem* SlotItem, const UXIUItemDefinition* ItemDefinition, UXIUItem* Item)
+{
+	return Item ? SlotItem != Item && SlotItem->CanStack(Item) : SlotItem->GetItemDefinition() == ItemDefinition;
+}
+
+int32 FXIUInventoryList::CommitPlacement(const FXIUInventoryPlacementPlan& Plan, TFunctionRef<UXIUItem*(int32, int32)> MakeStack, TFunctionRef<void(UXIUItem*)> DiscardStack, TArray<UXIUItem*>& OutNewItems)
+{
+	int32 PlacedCount = 0;
+	for (const FXIUInventoryPlacementPlan::FPlacement& TopUp : Plan.TopUps)
+	{
+		if (UXIUItem* SlotItem = Entries[TopUp.EntryIndex].GetItemSafe())
+		{
+			PlacedCount += SlotItem->ModifyCount(TopUp.Count);
+		}
+	}
+	for (const FXIUInventoryPlacementPlan::FPlacement& NewStack : Plan.NewStacks)
+	{
+		UXIUItem* NewItem = MakeStack(NewStack.Count, PlacedCount);
+		if (!NewItem) continue;
+		
+		FXIUInventorySlot& Slot = Entries[NewStack.EntryIndex];
+		UXIUItem* OldItem;
+		if (!SetSlotItem(Slot, NewItem, OldItem))
+		{
+			DiscardStack(NewItem);
+			continue;
+		}
+		MarkItemDirty(Slot);
+		RegisterSlotChange(Slot, 0, NewItem->GetCount(), true, OldItem);
+		
+		OutNewItems.Add(NewItem);
+		PlacedCount += NewItem->GetCount();
+	}
+	return PlacedCount;
+}
+
+bool FXIUInventoryList::SetItemAtSlot(int32 SlotIndex, UXIUItem* Item, bool bDuplicate, UXIUItem*& AddedItem, UXIUItem*& OldItem)
+{
+	XIU_INVENTORY_TRACE_OP(Set);
+	check(CanManipulateInventory());
+	checkf(SlotIndex < GetSize(), TEXT("The slot at index %i does not exist"), SlotIndex)
+	
+	FXIUInventorySlot* SlotPtr = FindOrMaterializeSlot(SlotIndex);
+	if (!SlotPtr) return false;
+
+	// the item being replaced frees its weight and volume
+	if (Item)
+	{
+		const UXIUItem* ReplacedItem = SlotPtr->GetItemSafe();
+		const FXIUInventoryLoad FreedLoad = ReplacedItem ? GetUnitLoad(ReplacedItem->GetItemDefinition()) * ReplacedItem->GetCount() : FXIUInventoryLoad();
+		if (OwnerComponent->GetCountWithinCapacity(GetUnitLoad(Item->GetItemDefinition()), Item->GetCount(), FreedLoad) < Item->GetCount()) return false;
+	}
+	
+	if (UXIUItem* NewItem = bDuplicate ? UXIUInventoryUtilLibrary::DuplicateItem(OwnerComponent->GetOwner(), Item) : Item)
+	{
+		FXIUInventorySlot& Slot = *SlotPtr;
+		if (SetSlotItem(Slot, NewItem, OldItem))
+		{
+			MarkItemDirty(Slot);
+			RegisterSlotChange(Slot, 0, NewItem->GetCount(), true, OldItem);
+			
+			AddedItem = NewItem;
+			return true;
+		}
+	}
+	return false;
+}
+
+UXIUItem* FXIUInventoryList::GetItemAtSlot(const int32 SlotIndex)
+{
+	if (const FXIUInventorySlot* Slot = FindSlot(SlotIndex))
+	{
+		if (IsPaged()) TouchPage(GetPageIndex(SlotIndex));
+		return Slot->GetItemSafe();
+	}
+	return nullptr;
+}
+
+UXIUItem* FXIUInventoryList::LoadItemAtSlot(const int32 SlotIndex)
+{
+	if (const FXIUInventorySlot* Slot = FindResidentSlot(SlotIndex))
+	{
+		return Slot->GetItemSafe();
+	}
+	return nullptr;
+}
+
+UXIUItem* FXIUInventoryList::RemoveItemAtSlot(int32 SlotIndex)
+{
+	XIU_INVENTORY_TRACE_OP(Remove);
+	check(CanManipulateInventory());
+	checkf(SlotIndex < GetSize(), TEXT("The slot at index %i does not exist"), SlotIndex)
+
+	// a slot that was never written to has nothing to remove
+	FXIUInventorySlot* SlotPtr = FindResidentSlot(SlotIndex);
+	if (!SlotPtr) return nullptr;
+
+	UXIUItem* OldItem = nullptr;
+	FXIUInventorySlot& Slot = *SlotPtr;
+	WakeNetDormancy();
+	Slot.Clear(OldItem);
+
+	MarkItemDirty(Slot);
+	RegisterSlotChange(Slot, OldItem ? OldItem->GetCount() : 0, 0, true, OldItem);
+	
+	return OldItem;
+}
+
+bool FXIUInventoryList::GetItemsByClass(const TSubclassOf<UXIUItem> ItemClass, TArray<UXIUItem*>& FoundItems)
+{
+	for (FXIUInventorySlot& Slot : Entries)
+	{
+		if (!Slot.IsEmpty() && Slot.GetItem()->IsA(ItemClass))
+		{
+			FoundItems.Add(Slot.GetItem());
+		}
+	}
+	return FoundItems.Num() > 0;
+}
+
+int32 FXIUInventoryList::ConsumeItemByDefinition(const UXIUItemDefinition* ItemDefinition, const int32 Count)
+{
+	XIU_INVENTORY_TRACE_OP(Consume);
+	check(CanManipulateInventory());
+	if (!ItemDefinition) return 0;
+	
+	PageInDefinition(ItemDefinition);
+	
+	int32 CountLeftToConsume = Count;
+	for (int32 EntryIndex = 0; EntryIndex < Entries.Num(); EntryIndex++)
+	{
+		FXIUInventorySlot& Slot = Entries[EntryIndex];
+		if (!Slot.IsEmpty() && Slot.GetItem()->GetItemDefinition() == ItemDefinition)
+		{
+			CountLeftToConsume -= -Slot.GetItem()->ModifyCount(-CountLeftToConsume); // we are removing count, so the function returns a negative number representing the count removed
+			
+			if (CountLeftToConsume <= 0) break;
+		}
+	}
+	return Count - CountLeftToConsume; // Consumed items
+}
+
+int32 FXIUInventoryList::ConsumeRecipe(TConstArrayView<FXIUItemDefault> Ingredients, const int32 Multiplier)
+{
+	XIU_INVENTORY_TRACE_OP(Consume);
+	check(CanManipulateInventory());
+	if (Multiplier <= 0) return 0;
+
+	// merge ingredients with the same definition, and compute what we need of each
+	struct FIngredientPlan
+	{
+		const UXIUItemDefinition* ItemDefinition = nullptr;
+		int64 CountPerCraft = 0;
+		int64 Available = 0;
+		/** entries holding this ingredient, in slot order */
+		TArray<int32, TInlineAllocator<8>> EntryIndexes;
+	};
+	TArray<FIngredientPlan, TInlineAllocator<8>> Plans;
+	for (const FXIUItemDefault& Ingredient : Ingredients)
+	{
+		if (!Ingredient.ItemDefinition || Ingredient.Count <= 0) continue;
+		
+		FIngredientPlan* Plan = Plans.FindByPredicate([&Ingredient](const FIngredientPlan& Other) { return Other.ItemDefinition == Ingredient.ItemDefinition; });
+		if (!Plan)
+		{
+			Plan = &Plans.AddDefaulted_GetRef();
+			Plan->ItemDefinition = Ingredient.ItemDefinition;
+			PageInDefinition(Ingredient.ItemDefinition);
+		}
+		Plan->CountPerCraft += Ingredient.Count;
+	}
+	if (Plans.Num() == 0) return Multiplier;
+
+	// single pass to find how much of each ingredient we have, and where
+	for (int32 EntryIndex = 0; EntryIndex < Entries.Num(); EntryIndex++)
+	{
+		const UXIUItem* Item = Entries[EntryIndex].GetItemSafe();
+		if (!Item) continue;
+		
+		for (FIngredientPlan& Plan : Plans)
+		{
+			if (Plan.ItemDefinition == Item->GetItemDefinition())
+			{
+				Plan.Available += Item->GetCount();
+				Plan.EntryIndexes.Add(EntryIndex);
+				break;
+			}
+		}
+	}
+
+	int64 MaxMultiplier = MAX_int32;
+	for (const FIngredientPlan& Plan : Plans)
+	{
+		MaxMultiplier = FMath::Min(MaxMultiplier, Plan.Available / Plan.CountPerCraft);
+	}
+	if (MaxMultiplier < Multiplier) return static_cast<int32>(MaxMultiplier);
+
+	// commit. Listeners only get notified once everything is consumed, so they cannot change the plan under us
+	FXIUInventoryChangeBatchScope ChangeBatch(*this);
+	for (const FIngredientPlan& Plan : Plans)
+	{
+		int64 CountLeftToConsume = Plan.CountPerCraft * Multiplier;
+		for (const int32 EntryIndex : Plan.EntryIndexes)
+		{
+			UXIUItem* Item = Entries[EntryIndex].GetItem();
+			const int32 ToConsume = static_cast<int32>(FMath::Min<int64>(CountLeftToConsume, Item->GetCount()));
+			CountLeftToConsume += Item->ModifyCount(-ToConsume); // we are removing count, so the function returns a negative number representing the count removed
+			
+			if (CountLeftToConsume <= 0) break;
+		}
+		check(CountLeftToConsume <= 0);
+	}
+	return Multiplier;
+}
+
+int32 FXIUInventoryList::GetInsertableCount(const UXIUItemDefinition* ItemDefinition, const int32 Desired) const
+{
+	if (!ItemDefinition || Desired <= 0) return 0;
+	const int32 DesiredWithinCapacity = OwnerComponent ? OwnerComponent->GetCountWithinCapacity(GetUnitLoad(ItemDefinition), Desired) : Desired;
+	if (DesiredWithinCapacity <= 0) return 0;
+
+	// same rules as PlanPlacement, which AddItemDefault uses
+	const int32 MaxCount = FMath::Max(ItemDefinition->MaxCount, 1);
+	int64 Insertable = 0;
+	TArray<bool, TInlineAllocator<8>> GroupMatches;
+	MatchFilterGroups(ItemDefinition, ItemDefinition->ItemClass, GroupMatches);
+	for (int32 EntryIndex = 0; EntryIndex < Entries.Num(); EntryIndex++)
+	{
+		const FXIUInventorySlot& Slot = Entries[EntryIndex];
+		if (Slot.IsLocked()) continue;
+		
+		if (UXIUItem* SlotItem = Slot.GetItemSafe())
+		{
+			if (CanStackOnSlotItem(SlotItem, ItemDefinition, nullptr)) Insertable += FMath::Max(0, SlotItem->GetMaxCount() - SlotItem->GetCount());
+		}
+		else if (GroupMatches[GetEntryFilterGroup(EntryIndex)])
+		{
+			Insertable += MaxCount;
+		}
+		if (Insertable >= DesiredWithinCapacity) return DesiredWithinCapacity;
+	}
+	Insertable += GetInsertableCountOutsideResidentPages(ItemDefinition, ItemDefinition->ItemClass, MaxCount);
+	return static_cast<int32>(FMath::Min<int64>(Insertable, DesiredWithinCapacity));
+}
+
+int32 FXIUInventoryList::GetInsertableCount(UXIUItem* Item, const int32 Desired) const
+{
+	if (!UXIUItem::IsItemInitialized(Item)) return 0;
+	const int32 DesiredCount = Desired < 0 ? Item->GetCount() : Desired;
+	if (DesiredCount <= 0) return 0;
+	const int32 DesiredWithinCapacity = OwnerComponent ? OwnerComponent->GetCountWithinCapacity(GetUnitLoad(Item->GetItemDefinition()), DesiredCount) : DesiredCount;
+	if (DesiredWithinCapacity <= 0) return 0;
+
+	const int32 MaxCount = FMath::Max(Item->GetMaxCount(), 1);
+	int64 Insertable = 0;
+	for (const FXIUInventorySlot& Slot : Entries)
+	{
+		if (!CanInsertItemInSlot(Slot, Item)) continue;
+
+		const UXIUItem* SlotItem = Slot.GetItemSafe();
+		Insertable += SlotItem ? FMath::Max(0, SlotItem->GetMaxCount() - SlotItem->GetCount()) : MaxCount;
+		if (Insertable >= DesiredWithinCapacity) return DesiredWithinCapacity;
+	}
+	Insertable += GetInsertableCountOutsideResidentPages(Item->GetItemDefinition(), Item->GetClass(), MaxCount);
+	return static_cast<int32>(FMath::Min<int64>(Insertable, DesiredWithinCapacity));
+}
+
+void FXIUInventoryList::GatherItemCounts(TArray<TPair<const UXIUItemDefinition*, int32>>& OutItems) const
+{
+	for (const FXIUInventorySlot& Slot : Entries)
+	{
+		if (const UXIUItem* Item = Slot.GetItemSafe())
+		{
+			OutItems.Emplace(Item->GetItemDefinition(), Item->GetCount());
+		}
+	}
+	for (const FXIUInventoryPage& Page : Pages)
+	{
+		if (Page.State != EXIUInventoryPageState::Stored) continue;
+		for (const FXIUItemDefault& Stored : Page.StoredItems)
+		{
+			OutItems.Emplace(Stored.ItemDefinition, Stored.Count);
+		}
+	}
+	for (const TPair<const UXIUItemDefinition*, int32>& Nested : NestedItemCounts)
+	{
+		OutItems.Add(Nested);
+	}
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Items registration */
+
+void FXIUInventoryList::RegisterSlotChange(const FXIUInventorySlot& Slot, const int32 OldCount, const int32 NewCount, const bool bRegisterItemChange, UXIUItem* OldItem)
+{
+	// keep counters up to date before anyone listening to the change message queries them
+	UpdateSlotTracking(Slot, NewCount);
+	MarkSlotChanged(Slot.GetIndex());
+	if (Journal)
+	{
+		const UXIUItem* Item = Slot.GetItem();
+		const EXIUJournalOp Op = bRegisterItemChange ? EXIUJournalOp::Item : EXIUJournalOp::Count;
+		Journal->Record(Op, Slot.GetIndex(), NewCount > 0 && Item ? Item->GetItemDefinition() : nullptr, NewCount - OldCount, NewCount);
+	}
+	XIU_INVENTORY_TRACE_SLOT_CHANGE(GetTraceOwner(), Slot.GetIndex(), Slot.GetItem() ? Slot.GetItem()->GetItemDefinition() : OldItem ? OldItem->GetItemDefinition() : nullptr, NewCount - OldCount, NewCount, bRegisterItemChange);
+	if (IsPaged()) TouchPage(GetPageIndex(Slot.GetIndex()));
+	
+	if (bRegisterItemChange)
+	{
+		// if new item is not initialized, we register it, and it will notify us when it gets initialized.
+		// otherwise if the item is not empty, we register it, and it will notify us when its count changes
+		if (UXIUItem* NewItem = Slot.GetItem())
+		{
+			if (!NewItem->IsItemInitialized())
+			{
+				RegisterSlotItem(Slot, NewItem);
+				SetItemOwner(NewItem, Slot.GetIndex());
+			}
+			else if (!NewItem->IsEmpty())
+			{
+				RegisterSlotItem(Slot, NewItem);
+				SetItemOwner(NewItem, Slot.GetIndex());
+				if (UXIUContainerItem* Container = Cast<UXIUContainerItem>(NewItem)) AttachContainer(Container);
+			}
+			else
+			{
+				// an empty item is on its way out of the slot, so it has nothing left to tell us
+				ClearItemOwner(NewItem, Slot.GetIndex());
+			}
+		}
+	}
+
+	// Broadcast change
+	BroadcastChangeMessage(Slot, OldCount, NewCount, OldItem); 
+
+	if (bRegisterItemChange)
+	{
+		// if the old item is valid, we unregister it and stop listening to it
+		if (OldItem)
+		{
+			if (UXIUContainerItem* Container = Cast<UXIUContainerItem>(OldItem)) DetachContainer(Container);
+			ClearItemOwner(OldItem, Slot.GetIndex());
+			OwnerComponent->UnregisterReplicatedObject(OldItem, true);
+		}
+	}
+}
+
+void FXIUInventoryList::WakeNetDormancy() const
+{
+	// a dormant owner would not send the change (and the item subobjects) to clients
+	if (CanManipulateInventory()) OwnerComponent->WakeOwnerNetDormancy();
+}
+
+void FXIUInventoryList::ClearItemOwners()
+{
+	for (const FXIUInventorySlot& Slot : Entries)
+	{
+		if (Slot.Item) ClearItemOwner(Slot.Item, Slot.Index);
+	}
+}
+
+void FXIUInventoryList::SetItemOwner(UXIUItem* Item, const int32 SlotIndex)
+{
+	Item->OwnerList = this;
+	Item->OwnerSlotIndex = SlotIndex;
+}
+
+void FXIUInventoryList::ClearItemOwner(UXIUItem* Item, const int32 SlotIndex)
+{
+	if (Item->OwnerList != this || Item->OwnerSlotIndex != SlotIndex) return;
+	Item->OwnerList = nullptr;
+	Item->OwnerSlotIndex = INDEX_NONE;
+}
+
+void FXIUInventoryList::OnItemCountChanged(UXIUItem* Item, const int32 OldCount)
+{
+	const FXIUInventorySlot* Slot = FindSlot(Item->OwnerSlotIndex);
+	if (!Slot || Slot->GetItem() != Item) return;
+
+	if (CanManipulateInventory())
+	{
+		const bool bItemChanged = Item->GetCount() == 0;
+		RegisterSlotChange(*Slot, OldCount, Item->GetCount(), bItemChanged, bItemChanged ? Item : nullptr);
+	}
+	else
+	{
+		TArray<int32> ChangedIndex = { static_cast<int32>(Slot - Entries.GetData()) };
+		PostReplicatedChange(ChangedIndex, Entries.Num());
+	}
+}
+
+void FXIUInventoryList::OnItemInitialized(UXIUItem* Item)
+{
+	const FXIUInventorySlot* Slot = FindSlot(Item->OwnerSlotIndex);
+	if (!Slot || Slot->GetItem() != Item) return;
+
+	if (CanManipulateInventory())
+	{
+		RegisterSlotChange(*Slot, 0, Item->GetCount(), true, nullptr);
+	}
+	else
+	{
+		TArray<int32> ChangedIndex = { static_cast<int32>(Slot - Entries.GetData()) };
+		PostReplicatedChange(ChangedIndex, Entries.Num());
+	}
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Occupancy tracking */
+
+int32 FXIUInventoryList::GetFirstOccupiedSlotIndex() const
+{
+	if (OccupiedSlotCount <= 0) return INDEX_NONE;
+
+	// the cursor only moves forward until a lower slot gets occupied, so draining an inventory is linear overall
+	while (FirstOccupiedSlotCursor < TrackedSlotCounts.Num() && TrackedSlotCounts[FirstOccupiedSlotCursor] <= 0)
+	{
+		FirstOccupiedSlotCursor++;
+	}
+	return TrackedSlotCounts.IsValidIndex(FirstOccupiedSlotCursor) ? FirstOccupiedSlotCursor : INDEX_NONE;
+}
+
+FXIUInventoryLoad FXIUInventoryList::GetUnitLoad(const UXIUItemDefinition* ItemDefinition)
+{
+	if (const UXIUCapacityFragment* CapacityFragment = ItemDefinition ? ItemDefinition->FindFragmentByClass<UXIUCapacityFragment>() : nullptr)
+	{
+		return FXIUInventoryLoad::FromUnits(CapacityFragment->Weight, CapacityFragment->Volume);
+	}
+	return FXIUInventoryLoad();
+}
+
+void FXIUInventoryList::UpdateSlotTracking(const FXIUInventorySlot& Slot, const int32 NewCount)
+{
+	const int32 SlotIndex = Slot.GetIndex();
+	if (SlotIndex < 0) return;
+	
+	const int32 Count = FMath::Max(NewCount, 0);
+
+	// load is only tracked by the server, and replicated as a single value
+	if (CanManipulateInventory())
+	{
+		const UXIUItem* Item = Slot.GetItem();
+		const FXIUInventoryLoad NewLoad = Count > 0 && Item ? GetUnitLoad(Item->GetItemDefinition()) * Count : FXIUInventoryLoad();
+		if (!NewLoad.IsZero() || TrackedSlotLoads.IsValidIndex(SlotIndex))
+		{
+			if (!TrackedSlotLoads.IsValidIndex(SlotIndex)) TrackedSlotLoads.SetNum(SlotIndex + 1);
+			const FXIUInventoryLoad LoadDelta = NewLoad - TrackedSlotLoads[SlotIndex];
+			TrackedSlotLoads[SlotIndex] = NewLoad;
+			if (!LoadDelta.IsZero())
+			{
+				if (OwnerContainer) OwnerContainer->ApplyContentsDelta(nullptr, 0, LoadDelta);
+				else OwnerComponent->UpdateLoad(LoadDelta);
+			}
+		}
+	}
+
+	// containers report what changed in them by definition, so that whoever holds them never needs to look inside
+	if (OwnerContainer)
+	{
+		const UXIUItem* Item = Slot.GetItem();
+		const UXIUItemDefinition* NewDefinition = Count > 0 && Item ? Item->GetItemDefinition() : nullptr;
+		const int32 TrackedCount = TrackedSlotCounts.IsValidIndex(SlotIndex) ? TrackedSlotCounts[SlotIndex] : 0;
+		if (!TrackedSlotDefinitions.IsValidIndex(SlotIndex)) TrackedSlotDefinitions.SetNumZeroed(SlotIndex + 1);
+		
+		const UXIUItemDefinition*& TrackedDefinition = TrackedSlotDefinitions[SlotIndex];
+		if (TrackedDefinition != NewDefinition)
+		{
+			if (TrackedDefinition && TrackedCount > 0) OwnerContainer->ApplyContentsDelta(TrackedDefinition, -TrackedCount, FXIUInventoryLoad());
+			if (NewDefinition) OwnerContainer->ApplyContentsDelta(NewDefinition, Count, FXIUInventoryLoad());
+			TrackedDefinition = NewDefinition;
+		}
+		else if (NewDefinition && Count != TrackedCount)
+		{
+			OwnerContainer->ApplyContentsDelta(NewDefinition, Count - TrackedCount, FXIUInventoryLoad());
+		}
+	}
+
+	if (!TrackedSlotCounts.IsValidIndex(SlotIndex))
+	{
+		if (Count == 0) return;
+		TrackedSlotCounts.SetNumZeroed(SlotIndex + 1);
+	}
+
+	int32& TrackedCount = TrackedSlotCounts[SlotIndex];
+	const int32 CountDelta = Count - TrackedCount;
+	const int32 OccupiedDelta = (Count > 0 ? 1 : 0) - (TrackedCount > 0 ? 1 : 0);
+	TotalItemCount += CountDelta;
+	OccupiedSlotCount += OccupiedDelta;
+	if (OccupiedDelta > 0)
+	{
+		FirstOccupiedSlotCursor = FMath::Min(FirstOccupiedSlotCursor, SlotIndex);
+	}
+	TrackedCount = Count;
+
+	if (bWindowedReplication && CountDelta != 0)
+	{
+		OwnerComponent->UpdatePageSummary(SlotIndex, OccupiedDelta, CountDelta);
+	}
+}
+
+void FXIUInventoryList::ResetSlotTracking()
+{
+	TrackedSlotCounts.Empty();
+	TrackedSlotLoads.Empty();
+	TrackedSlotDefinitions.Empty();
+	NestedItemCounts.Empty();
+	if (OwnerContainer)
+	{
+		OwnerContainer->ResetContentsAggregates();
+	}
+	else if (CanManipulateInventory())
+	{
+		OwnerComponent->ResetLoad();
+	}
+	OccupiedSlotCount = 0;
+	TotalItemCount = 0;
+	FirstOccupiedSlotCursor = 0;
+
+	if (bWindowedReplication)
+	{
+		OwnerComponent->ResetPageSummaries();
+	}
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Change generations */
+
+uint32 FXIUInventoryList::GetChangesSince(const uint32 SinceGeneration, TArray<int32>& OutSlots) const
+{
+	if (SinceGeneration >= Generation) return Generation;
+	
+	for (int32 SlotIndex = 0; SlotIndex < SlotGenerations.Num(); SlotIndex++)
+	{
+		if (SlotGenerations[SlotIndex] > SinceGeneration) OutSlots.Add(SlotIndex);
+	}
+	return Generation;
+}
+
+void FXIUInventoryList::MarkSlotChanged(const int32 SlotIndex)
+{
+	if (SlotIndex < 0) return;
+	if (!SlotGenerations.IsValidIndex(SlotIndex)) SlotGenerations.SetNumZeroed(SlotIndex + 1);
+	SlotGenerations[SlotIndex] = ++Generation;
+}
+
+void FXIUInventoryList::MarkRemovedSlotsChanged(const int32 NewSize)
+{
+	for (int32 SlotIndex = FMath::Max(NewSize, 0); SlotIndex < GetSize(); SlotIndex++)
+	{
+		MarkSlotChanged(SlotIndex);
+	}
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Nested containers */
+
+int32 FXIUInventoryList::CountNestedItemsByDefinition(const UXIUItemDefinition* ItemDefinition) const
+{
+	const int32* Count = NestedItemCounts.Find(ItemDefinition);
+	return Count ? *Count : 0;
+}
+
+void FXIUInventoryList::ApplyNestedDelta(const UXIUItemDefinition* ItemDefinition, const int32 CountDelta, const FXIUInventoryLoad& LoadDelta)
+{
+	if (ItemDefinition && CountDelta != 0)
+	{
+		int32& NestedCount = NestedItemCounts.FindOrAdd(ItemDefinition);
+		NestedCount += CountDelta;
+		if (NestedCount == 0) NestedItemCounts.Remove(ItemDefinition);
+	}
+
+	if (OwnerContainer)
+	{
+		OwnerContainer->ApplyContentsDelta(ItemDefinition, CountDelta, LoadDelta);
+	}
+	else if (!LoadDelta.IsZero() && CanManipulateInventory())
+	{
+		OwnerComponent->UpdateLoad(LoadDelta);
+	}
+}
+
+void FXIUInventoryList::AttachContainer(UXIUContainerItem* Container)
+{
+	check(Container && &Container->Contents != this);
+	if (Container->ParentList == this) return;
+	if (Container->ParentList) Container->ParentList->DetachContainer(Container);
+
+	Container->ParentList = this;
+	Container->Contents.OwnerComponent = OwnerComponent;
+	for (const TPair<const UXIUItemDefinition*, int32>& Aggregate : Container->AggregateCounts)
+	{
+		ApplyNestedDelta(Aggregate.Key, Aggregate.Value, FXIUInventoryLoad());
+	}
+	if (!Container->ContentLoad.IsZero()) ApplyNestedDelta(nullptr, 0, Container->ContentLoad);
+
+	// whatever the container loads now reaches us through the usual deltas
+	Container->OnAttached();
+}
+
+void FXIUInventoryList::DetachContainer(UXIUContainerItem* Container, const bool bKeepAggregates)
+{
+	check(Container);
+	if (Container->ParentList != this) return;
+	if (bKeepAggregates)
+	{
+		Container->ParentList = nullptr;
+		return;
+	}
+	
+	for (const TPair<const UXIUItemDefinition*, int32>& Aggregate : Container->AggregateCounts)
+	{
+		ApplyNestedDelta(Aggregate.Key, -Aggregate.Value, FXIUInventoryLoad());
+	}
+	if (!Container->ContentLoad.IsZero()) ApplyNestedDelta(nullptr, 0, FXIUInventoryLoad() - Container->ContentLoad);
+	Container->ParentList = nullptr;
+}
+
+const UObject* FXIUInventoryList::GetTraceOwner() const
+{
+	if (OwnerContainer) return OwnerContainer;
+	return OwnerComponent;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Snapshot */
+
+namespace XIUInventorySnapshot
+{
+	static constexpr uint32 Magic = 0x53554958; // "XIUS"
+
+	enum class EVersion : uint8
+	{
+		Initial = 1,
+		TagFilters = 2,
+
+		// add new versions above this line
+		VersionPlusOne,
+		Latest = VersionPlusOne - 1
+	};
+
+	enum ESlotFlags : uint8
+	{
+		HasItem = 1 << 0,
+		Locked = 1 << 1,
+		HasFilter = 1 << 2,
+		HasTagFilter = 1 << 3
+	};
+
+	/** Slot read from a snapshot. Item data is left in the archive and read after the item is created */
+	struct FSlotRecord
+	{
+		uint8 Flags = 0;
+		uint32 FilterIndex = 0;
+		uint32 DefinitionIndex = 0;
+		uint32 Count = 0;
+		int64 DataOffset = 0;
+		uint32 DataSize = 0;
+		FGameplayTagContainer RequiredTags;
+		FGameplayTagContainer BlockedTags;
+	};
+
+	struct FSnapshot
+	{
+		TArray<UXIUItemDefinition*> Definitions;
+		TArray<UClass*> Filters;
+		TArray<FSlotRecord> Records;
+		int64 EndOffset = 0;
+
+		FXIUInventorySlotSettings GetSettings(const FSlotRecord& Record) const
+		{
+			FXIUInventorySlotSettings Settings;
+			Settings.Filter = (Record.Flags & HasFilter) ? Filters[Record.FilterIndex] : nullptr;
+			Settings.bLocked = (Record.Flags & Locked) != 0;
+			Settings.RequiredTags = Record.RequiredTags;
+			Settings.BlockedTags = Record.BlockedTags;
+			return Settings;
+		}
+
+		FXIUItemDefault GetItemDefault(const FSlotRecord& Record) const
+		{
+			if (!(Record.Flags & HasItem)) return FXIUItemDefault();
+			return FXIUItemDefault(Definitions[Record.DefinitionIndex], FMath::Min<uint32>(Record.Count, MAX_int32));
+		}
+	};
+
+	template<typename ObjectType>
+	void WritePathTable(FArchive& Ar, const TArray<ObjectType*>& Table)
+	{
+		uint32 Num = Table.Num();
+		Ar.SerializeIntPacked(Num);
+		for (ObjectType* Object : Table)
+		{
+			FString Path = Object->GetPathName();
+			Ar << Path;
+		}
+	}
+
+	/** Tags are written by name, so that the snapshot does not depend on the order of the tag table */
+	void SerializeTags(FArchive& Ar, FGameplayTagContainer& Tags)
+	{
+		uint32 Num = Tags.Num();
+		Ar.SerializeIntPacked(Num);
+		if (Ar.IsSaving())
+		{
+			for (const FGameplayTag& Tag : Tags)
+			{
+				FString TagName = Tag.ToString();
+				Ar << TagName;
+			}
+			return;
+		}
+		
+		Tags.Reset();
+		for (uint32 i = 0; i < Num && !Ar.IsError(); i++)
+		{
+			FString TagName;
+			Ar << TagName;
+			const FGameplayTag Tag = FGameplayTag::RequestGameplayTag(FName(*TagName), false);
+			if (Tag.IsValid()) Tags.AddTag(Tag);
+			else UE_LOG(LogTemp, Error, TEXT("XIUInventorySnapshot::SerializeTags -> Tag [%s] does not exist anymore"), *TagName)
+		}
+	}
+
+	/** @param Slots: slots to write, in index order. nullptr is written as an empty slot with default settings */
+	void Write(FArchive& Ar, TConstArrayView<const FXIUInventorySlot*> Slots)
+	{
+		check(Ar.IsSaving());
+		
+		// definitions and filters are stored once and referenced by index
+		TArray<UXIUItemDefinition*> Definitions;
+		TArray<UClass*> Filters;
+		for (const FXIUInventorySlot* Slot : Slots)
+		{
+			if (!Slot) continue;
+			if (UXIUItem* Item = Slot->GetItemSafe()) Definitions.AddUnique(Item->GetItemDefinition());
+			if (Slot->GetFilter()) Filters.AddUnique(Slot->GetFilter().Get());
+		}
+
+		uint32 SnapshotMagic = Magic;
+		uint8 Version = static_cast<uint8>(EVersion::Latest);
+		Ar << SnapshotMagic;
+		Ar << Version;
+		WritePathTable(Ar, Definitions);
+		WritePathTable(Ar, Filters);
+
+		uint32 SlotCount = Slots.Num();
+		Ar.SerializeIntPacked(SlotCount);
+
+		TArray<uint8> ItemData;
+		for (const FXIUInventorySlot* Slot : Slots)
+		{
+			UXIUItem* Item = Slot ? Slot->GetItemSafe() : nullptr;
+			const TSubclassOf<UXIUItem> Filter = Slot ? Slot->GetFilter() : nullptr;
+			const bool bTagFilter = Slot && Slot->HasTagFilter();
+			uint8 Flags = (Item ? HasItem : 0) | (Slot && Slot->IsLocked() ? Locked : 0) | (Filter ? HasFilter : 0) | (bTagFilter ? HasTagFilter : 0);
+			Ar << Flags;
+
+			if (Filter)
+			{
+				uint32 FilterIndex = Filters.IndexOfByKey(Filter.Get());
+				Ar.SerializeIntPacked(FilterIndex);
+			}
+
+			if (bTagFilter)
+			{
+				FGameplayTagContainer RequiredTags = Slot->GetRequiredTags();
+				FGameplayTagContainer BlockedTags = Slot->GetBlockedTags();
+				SerializeTags(Ar, RequiredTags);
+				SerializeTags(Ar, BlockedTags);
+			}
+
+			if (Item)
+			{
+				uint32 DefinitionIndex = Definitions.IndexOfByKey(Item->GetItemDefinition());
+				uint32 Count = Item->GetCount();
+				Ar.SerializeIntPacked(DefinitionIndex);
+				Ar.SerializeIntPacked(Count);
+
+				// item data is size prefixed so that on load each item only gets to read its own data
+				ItemData.Reset();
+				FMemoryWriter ItemWriter(ItemData);
+				Item->SerializeSnapshotData(ItemWriter);
+				uint32 DataSize = ItemData.Num();
+				Ar.SerializeIntPacked(DataSize);
+				if (DataSize > 0) Ar.Serialize(ItemData.GetData(), DataSize);
+			}
+		}
+	}
+
+	/** Reads and validates a whole snapshot, leaving the archive at its end
+	 * @return false if the snapshot is invalid */
+	bool Read(FArchive& Ar, FSnapshot& OutSnapshot)
+	{
+		check(Ar.IsLoading());
+		
+		uint32 SnapshotMagic = 0;
+		uint8 Version = 0;
+		Ar << SnapshotMagic;
+		Ar << Version;
+		if (Ar.IsError() || SnapshotMagic != Magic || Version == 0 || Version > static_cast<uint8>(EVersion::Latest))
+		{
+			UE_LOG(LogTemp, Error, TEXT("XIUInventorySnapshot::Read -> Invalid snapshot header (version %i)"), Version)
+			return false;
+		}
+
+		uint32 DefinitionNum = 0;
+		Ar.SerializeIntPacked(DefinitionNum);
+		for (uint32 i = 0; i < DefinitionNum && !Ar.IsError(); i++)
+		{
+			FString Path;
+			Ar << Path;
+			UXIUItemDefinition* Definition = Cast<UXIUItemDefinition>(FSoftObjectPath(Path).TryLoad());
+			if (!Definition || !Definition->ItemClass)
+			{
+				UE_LOG(LogTemp, Error, TEXT("XIUInventorySnapshot::Read -> Item definition [%s] could not be loaded"), *Path)
+				return false;
+			}
+			OutSnapshot.Definitions.Add(Definition);
+		}
+
+		uint32 FilterNum = 0;
+		Ar.SerializeIntPacked(FilterNum);
+		for (uint32 i = 0; i < FilterNum && !Ar.IsError(); i++)
+		{
+			FString Path;
+			Ar << Path;
+			UClass* Filter = FSoftClassPath(Path).TryLoadClass<UXIUItem>();
+			if (!Filter)
+			{
+				UE_LOG(LogTemp, Error, TEXT("XIUInventorySnapshot::Read -> Filter class [%s] could not be loaded"), *Path)
+				return false;
+			}
+			OutSnapshot.Filters.Add(Filter);
+		}
+
+		uint32 SlotCount = 0;
+		Ar.SerializeIntPacked(SlotCount);
+		if (Ar.IsError() || static_cast<int64>(SlotCount) > Ar.TotalSize() - Ar.Tell()) // each slot takes at least 1 byte
+		{
+			UE_LOG(LogTemp, Error, TEXT("XIUInventorySnapshot::Read -> Corrupted snapshot"))
+			return false;
+		}
+
+		OutSnapshot.Records.SetNum(SlotCount);
+		for (FSlotRecord& Record : OutSnapshot.Records)
+		{
+			Ar << Record.Flags;
+			if (Record.Flags & HasFilter) Ar.SerializeIntPacked(Record.FilterIndex);
+			if (Record.Flags & HasTagFilter)
+			{
+				SerializeTags(Ar, Record.RequiredTags);
+				SerializeTags(Ar, Record.BlockedTags);
+			}
+			if (Record.Flags & HasItem)
+			{
+				Ar.SerializeIntPacked(Record.DefinitionIndex);
+				Ar.SerializeIntPacked(Record.Count);
+				Ar.SerializeIntPacked(Record.DataSize);
+				Record.DataOffset = Ar.Tell();
+
+				// memory archives assert when seeking past their end
+				if (Ar.IsError() || static_cast<int64>(Record.DataSize) > Ar.TotalSize() - Ar.Tell())
+				{
+					UE_LOG(LogTemp, Error, TEXT("XIUInventorySnapshot::Read -> Corrupted snapshot"))
+					return false;
+				}
+				Ar.Seek(Record.DataOffset + Record.DataSize);
+			}
+
+			const bool bValidFilter = !(Record.Flags & HasFilter) || OutSnapshot.Filters.IsValidIndex(Record.FilterIndex);
+			const bool bValidItem = !(Record.Flags & HasItem) || (OutSnapshot.Definitions.IsValidIndex(Record.DefinitionIndex) && Record.Count > 0);
+			if (Ar.IsError() || !bValidFilter || !bValidItem)
+			{
+				UE_LOG(LogTemp, Error, TEXT("XIUInventorySnapshot::Read -> Corrupted snapshot"))
+				return false;
+			}
+		}
+		OutSnapshot.EndOffset = Ar.Tell();
+		return true;
+	}
+
+	/** Gives the item a reader over its own data only, so a corrupted item can not read (or allocate) past it
+	 * @return false if the item failed to read its data, or did not read all of it */
+	bool ReadItemData(UXIUItem* Item, FArchive& Ar, const int64 DataOffset, const int64 DataSize)
+	{
+		TArray<uint8> Data;
+		Data.SetNumUninitialized(DataSize);
+		Ar.Seek(DataOffset);
+		Ar.Serialize(Data.GetData(), DataSize);
+		if (Ar.IsError()) return false;
+
+		FMemoryReader ItemReader(Data);
+		ItemReader.ArMaxSerializeSize = DataSize;
+		Item->SerializeSnapshotData(ItemReader);
+		return !ItemReader.IsError() && ItemReader.Tell() == DataSize;
+	}
+
+	/** Creates the items of the snapshot (indexed like its records) and reads their data, before anything in the
+	 * inventory changes
+	 * @return false if an item could not be created, or its data is corrupted */
+	bool MakeItems(const FSnapshot& Snapshot, FArchive& Ar, UObject* Outer, TArray<UXIUItem*>& OutItems)
+	{
+		OutItems.SetNumZeroed(Snapshot.Records.Num());
+		for (int32 i = 0; i < Snapshot.Records.Num(); i++)
+		{
+			const FSlotRecord& Record = Snapshot.Records[i];
+			const FXIUItemDefault ItemDefault = Snapshot.GetItemDefault(Record);
+			if (!ItemDefault.ItemDefinition) continue;
+
+			UXIUItem* Item = UXIUInventoryUtilLibrary::MakeItemFromDefault(Outer, ItemDefault);
+			if (!Item || (Record.DataSize > 0 && !ReadItemData(Item, Ar, Record.DataOffset, Record.DataSize)))
+			{
+				UE_LOG(LogTemp, Error, TEXT("XIUInventorySnapshot::MakeItems -> Item of record %i could not be restored"), i)
+				return false;
+			}
+			OutItems[i] = Item;
+		}
+		return true;
+	}
+}
+
+void FXIUInventoryList::SaveSnapshot(FArchive& Ar)
+{
+	// stored pages are loaded back, so that the snapshot is complete
+	PageInAll();
+	
+	// slots are written in index order, so loading does not need to store indexes
+	TArray<const FXIUInventorySlot*> Slots;
+	Slots.Reserve(GetSize());
+	for (int32 SlotIndex = 0; SlotIndex < GetSize(); SlotIndex++)
+	{
+		Slots.Add(FindSlot(SlotIndex));
+	}
+	XIUInventorySnapshot::Write(Ar, Slots);
+}
+
+bool FXIUInventoryList::LoadSnapshot(FArchive& Ar)
+{
+	XIU_INVENTORY_TRACE_OP(Snapshot);
+	using namespace XIUInventorySnapshot;
+	check(CanManipulateInventory());
+
+	// read everything before touching the inventory, so an invalid snapshot leaves it as it was
+	FSnapshot Snapshot;
+	if (!Read(Ar, Snapshot)) return false;
+	TArray<UXIUItem*> NewItems;
+	if (!MakeItems(Snapshot, Ar, OwnerComponent->GetOwner(), NewItems)) return false;
+	WakeNetDormancy();
+	const int32 SlotCount = Snapshot.Records.Num();
+
+	// drop old items
+	for (FXIUInventorySlot& Slot : Entries)
+	{
+		UXIUItem* OldItem;
+		if (Slot.Clear(OldItem))
+		{
+			if (UXIUContainerItem* Container = Cast<UXIUContainerItem>(OldItem)) DetachContainer(Container);
+			ClearItemOwner(OldItem, Slot.GetIndex());
+			OwnerComponent->UnregisterReplicatedObject(OldItem, true);
+		}
+	}
+	ResetSlotTracking();
+	MarkRemovedSlotsChanged(SlotCount);
+
+	if (IsPaged())
+	{
+		// only pages with items or custom settings get created
+		ResetPages(SlotCount);
+		for (int32 i = 0; i < SlotCount; i++)
+		{
+			const FSlotRecord& Record = Snapshot.Records[i];
+			if (Record.Flags == 0) continue;
+			
+			if (FXIUInventorySlot* Slot = FindOrMaterializeSlot(i))
+			{
+				RestoreSlot(*Slot, Snapshot.GetSettings(Record), NewItems[i]);
+			}
+		}
+	}
+	else
+	{
+		// reuse existing entries so that their replication IDs are kept, and only add or remove the difference
+		if (Entries.Num() > SlotCount)
+		{
+			Entries.SetNum(SlotCount);
+			MarkArrayDirty();
+		}
+		Entries.Reserve(SlotCount);
+		while (Entries.Num() < SlotCount)
+		{
+			Entries.AddDefaulted();
+		}
+
+		for (int32 i = 0; i < SlotCount; i++)
+		{
+			const FSlotRecord& Record = Snapshot.Records[i];
+			Entries[i].Index = i;
+			RestoreSlot(Entries[i], Snapshot.GetSettings(Record), NewItems[i]);
+		}
+	}
+	Ar.Seek(Snapshot.EndOffset);
+	SlotLayoutVersion++;
+	return true;
+}
+
+void FXIUInventoryList::RestoreSlot(FXIUInventorySlot& Slot, const FXIUInventorySlotSettings& Settings, UXIUItem* NewItem, const bool bRecordInJournal)
+{
+	// slot settings are restored as saved, so we bypass filter and lock checks of FXIUInventorySlot::SetItem
+	ApplySlotSettings(Slot, Settings);
+	InvalidateFilterGroups();
+	Slot.Item = NewItem;
+	
+	if (NewItem)
+	{
+		RegisterSlotItem(Slot, NewItem);
+		SetItemOwner(NewItem, Slot.GetIndex());
+		UpdateSlotTracking(Slot, NewItem->GetCount());
+		if (UXIUContainerItem* Container = Cast<UXIUContainerItem>(NewItem)) AttachContainer(Container);
+	}
+	MarkItemDirty(Slot);
+	MarkSlotChanged(Slot.GetIndex());
+	if (Journal && bRecordInJournal)
+	{
+		Journal->Record(EXIUJournalOp::Item, Slot.GetIndex(), NewItem ? NewItem->GetItemDefinition() : nullptr, NewItem ? NewItem->GetCount() : 0, NewItem ? NewItem->GetCount() : 0);
+	}
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Paged storage */
+
+void FXIUInventoryList::EnablePagedStorage(const int32 InSlotsPerPage, const TSharedPtr<FXIUInventoryPageStore>& InPageStore)
+{
+	checkf(Entries.Num() == 0, TEXT("Paged storage must be enabled before the inventory is initialized"))
+	checkf(InSlotsPerPage > 0, TEXT("A page must contain at least one slot"))
+	
+	SlotsPerPage = InSlotsPerPage;
+	PageStore = InPageStore;
+}
+
+void FXIUInventoryList::SetPagingInfo(const int32 InSlotsPerPage, const int32 InSlotCount)
+{
+	SlotsPerPage = InSlotsPerPage;
+	PagedSlotCount = InSlotCount;
+}
+
+EXIUInventoryPageState FXIUInventoryList::GetPageState(const int32 PageIndex) const
+{
+	return Pages.IsValidIndex(PageIndex) ? Pages[PageIndex].State : EXIUInventoryPageState::Unallocated;
+}
+
+void FXIUInventoryList::ResetPages(const int32 SlotCount)
+{
+	for (int32 PageIndex = 0; PageIndex < Pages.Num(); PageIndex++)
+	{
+		if (Pages[PageIndex].State == EXIUInventoryPageState::Stored && PageStore)
+		{
+			PageStore->RemovePage(PageIndex);
+		}
+	}
+	if (Entries.Num() > 0)
+	{
+		Entries.Empty();
+		MarkArrayDirty();
+	}
+	
+	PagedSlotCount = SlotCount;
+	Pages.Empty();
+	Pages.SetNum(FMath::DivideAndRoundUp(SlotCount, SlotsPerPage));
+	SlotLayoutVersion++;
+}
+
+FXIUInventorySlot* FXIUInventoryList::FindOrMaterializeSlot(const int32 SlotIndex)
+{
+	if (!IsPaged()) return FindSlot(SlotIndex);
+	if (SlotIndex < 0 || SlotIndex >= PagedSlotCount) return nullptr;
+
+	const int32 PageIndex = GetPageIndex(SlotIndex);
+	switch (Pages[PageIndex].State)
+	{
+	case EXIUInventoryPageState::Unallocated:
+		MaterializePage(PageIndex);
+		break;
+	case EXIUInventoryPageState::Stored:
+		if (!PageIn(PageIndex)) return nullptr;
+		break;
+	default:
+		break;
+	}
+	TouchPage(PageIndex);
+	return FindSlot(SlotIndex);
+}
+
+FXIUInventorySlot* FXIUInventoryList::FindResidentSlot(const int32 SlotIndex)
+{
+	if (IsPaged() && Pages.IsValidIndex(GetPageIndex(SlotIndex)))
+	{
+		const int32 PageIndex = GetPageIndex(SlotIndex);
+		if (Pages[PageIndex].State == EXIUInventoryPageState::Stored && !PageIn(PageIndex)) return nullptr;
+		TouchPage(PageIndex);
+	}
+	return FindSlot(SlotIndex);
+}
+
+void FXIUInventoryList::MaterializePage(const int32 PageIndex)
+{
+	check(Pages[PageIndex].State == EXIUInventoryPageState::Unallocated);
+	WakeNetDormancy();
+
+	// empty slots with default settings are not observable, so we do not broadcast anything for them
+	const int32 FirstSlot = PageIndex * SlotsPerPage;
+	const int32 LastSlot = FMath::Min(FirstSlot + SlotsPerPage, PagedSlotCount);
+	Entries.Reserve(Entries.Num() + LastSlot - FirstSlot);
+	for (int32 SlotIndex = FirstSlot; SlotIndex < LastSlot; SlotIndex++)
+	{
+		FXIUInventorySlot& NewSlot = Entries.AddDefaulted_GetRef();
+		NewSlot.Index = SlotIndex;
+		MarkItemDirty(NewSlot);
+	}
+	
+	Pages[PageIndex].State = EXIUInventoryPageState::Resident;
+	SlotLayoutVersion++;
+}
+
+bool FXIUInventoryList::MaterializePageWithFreeSlots()
+{
+	if (!IsPaged()) return false;
+	
+	for (int32 PageIndex = 0; PageIndex < Pages.Num(); PageIndex++)
+	{
+		if (Pages[PageIndex].State == EXIUInventoryPageState::Unallocated)
+		{
+			MaterializePage(PageIndex);
+			TouchPage(PageIndex);
+			return true;
+		}
+	}
+	for (int32 PageIndex = 0; PageIndex < Pages.Num(); PageIndex++)
+	{
+		if (Pages[PageIndex].State == EXIUInventoryPageState::Stored && Pages[PageIndex].StoredFreeSlots > 0)
+		{
+			return PageIn(PageIndex);
+		}
+	}
+	return false;
+}
+
+bool FXIUInventoryList::HasFreeSlotsOutsideResidentPages() const
+{
+	for (const FXIUInventoryPage& Page : Pages)
+	{
+		if (Page.State == EXIUInventoryPageState::Unallocated) return true;
+		if (Page.State == EXIUInventoryPageState::Stored && Page.StoredFreeSlots > 0) return true;
+	}
+	return false;
+}
+
+int64 FXIUInventoryList::GetInsertableCountOutsideResidentPages(const UXIUItemDefinition* ItemDefinition, const UClass* ItemClass, const int32 MaxCount) const
+{
+	int64 Insertable = 0;
+	for (int32 PageIndex = 0; PageIndex < Pages.Num(); PageIndex++)
+	{
+		const FXIUInventoryPage& Page = Pages[PageIndex];
+		if (Page.State == EXIUInventoryPageState::Unallocated)
+		{
+			// slots of an unallocated page have no filter
+			const int32 FirstSlot = PageIndex * SlotsPerPage;
+			Insertable += static_cast<int64>(FMath::Min(FirstSlot + SlotsPerPage, PagedSlotCount) - FirstSlot) * MaxCount;
+		}
+		else if (Page.State == EXIUInventoryPageState::Stored)
+		{
+			for (const FXIUInventoryStoredFreeSlots& FreeSlots : Page.StoredFreeSlotGroups)
+			{
+				if (MatchesGroupFilter(FreeSlots.Group, ItemDefinition, ItemClass)) Insertable += static_cast<int64>(FreeSlots.Count) * MaxCount;
+			}
+			for (const FXIUItemDefault& StackSpace : Page.StoredStackSpace)
+			{
+				if (StackSpace.ItemDefinition == ItemDefinition) Insertable += StackSpace.Count;
+			}
+		}
+	}
+	return Insertable;
+}
+
+void FXIUInventoryList::TouchPage(const int32 PageIndex)
+{
+	if (Pages.IsValidIndex(PageIndex))
+	{
+		Pages[PageIndex].LastAccessTime = FPlatformTime::Seconds();
+	}
+}
+
+bool FXIUInventoryList::PageIn(const int32 PageIndex)
+{
+	XIU_INVENTORY_TRACE_OP(Page);
+	using namespace XIUInventorySnapshot;
+	check(CanManipulateInventory());
+	if (!Pages.IsValidIndex(PageIndex)) return false;
+	if (Pages[PageIndex].State != EXIUInventoryPageState::Stored) return Pages[PageIndex].State == EXIUInventoryPageState::Resident;
+
+	TArray<uint8> Data;
+	FSnapshot Snapshot;
+	if (!PageStore || !PageStore->ReadPage(PageIndex, Data))
+	{
+		UE_LOG(LogTemp, Error, TEXT("FXIUInventoryList::PageIn -> Could not read page %i of [%s]"), PageIndex, *GetNameSafe(OwnerComponent))
+		return false;
+	}
+	FMemoryReader Reader(Data);
+	TArray<UXIUItem*> NewItems;
+	if (!Read(Reader, Snapshot) || !MakeItems(Snapshot, Reader, OwnerComponent->GetOwner(), NewItems))
+	{
+		UE_LOG(LogTemp, Error, TEXT("FXIUInventoryList::PageIn -> Page %i of [%s] is corrupted"), PageIndex, *GetNameSafe(OwnerComponent))
+		return false;
+	}
+
+	// the containers of the page report their contents again when restored, so the stored aggregates are removed first
+	FXIUInventoryPage& Page = Pages[PageIndex];
+	for (const FXIUItemDefault& Nested : Page.StoredNestedItems)
+	{
+		ApplyNestedDelta(Nested.ItemDefinition, -Nested.Count, FXIUInventoryLoad());
+	}
+	if (!Page.StoredNestedLoad.IsZero()) ApplyNestedDelta(nullptr, 0, FXIUInventoryLoad() - Page.StoredNestedLoad);
+	Page.State = EXIUInventoryPageState::Unallocated;
+	Page.StoredItems.Empty();
+	Page.StoredNestedItems.Empty();
+	Page.StoredNestedLoad = FXIUInventoryLoad();
+	Page.StoredStackSpace.Empty();
+	Page.StoredFreeSlotGroups.Empty();
+	Page.StoredFreeSlots = 0;
+	MaterializePage(PageIndex);
+
+	// the page has been created in order at the end of the array
+	const int32 FirstSlot = PageIndex * SlotsPerPage;
+	const int32 FirstEntry = Entries.Num() - (FMath::Min(FirstSlot + SlotsPerPage, PagedSlotCount) - FirstSlot);
+	for (int32 i = 0; i < Snapshot.Records.Num() && FirstEntry + i < Entries.Num(); i++)
+	{
+		const FSlotRecord& Record = Snapshot.Records[i];
+		// the content of the slot did not change, it only comes back in memory
+		RestoreSlot(Entries[FirstEntry + i], Snapshot.GetSettings(Record), NewItems[i], false);
+	}
+	
+	PageStore->RemovePage(PageIndex);
+	TouchPage(PageIndex);
+	return true;
+}
+
+bool FXIUInventoryList::PageOut(const int32 PageIndex)
+{
+	XIU_INVENTORY_TRACE_OP(Page);
+	check(CanManipulateInventory());
+	if (!Pages.IsValidIndex(PageIndex) || Pages[PageIndex].State != EXIUInventoryPageState::Resident) return false;
+	
+	// releasing the entries of a page removes them from the fast array, so it must not be replicated to anyone
+	if (IsPageReplicated(PageIndex)) return false;
+
+	const int32 FirstSlot = PageIndex * SlotsPerPage;
+	const int32 LastSlot = FMath::Min(FirstSlot + SlotsPerPage, PagedSlotCount);
+	
+	TArray<const FXIUInventorySlot*> Slots;
+	Slots.Reserve(LastSlot - FirstSlot);
+	bool bDefaultPage = true;
+	for (int32 SlotIndex = FirstSlot; SlotIndex < LastSlot; SlotIndex++)
+	{
+		const FXIUInventorySlot* Slot = FindSlot(SlotIndex);
+		bDefaultPage &= !Slot || (Slot->IsEmpty() && !Slot->IsLocked() && !Slot->GetFilter() && !Slot->HasTagFilter());
+		Slots.Add(Slot);
+	}
+
+	// a page with nothing to remember goes back to costing nothing, otherwise it needs to be stored
+	FXIUInventoryPage& Page = Pages[PageIndex];
+	if (!bDefaultPage)
+	{
+		if (!PageStore) return false;
+		
+		TArray<uint8> Data;
+		FMemoryWriter Writer(Data);
+		XIUInventorySnapshot::Write(Writer, Slots);
+		PageStore->WritePage(PageIndex, MoveTemp(Data));
+
+		// summary used to answer queries and to know which pages to load back, without reading the file
+		Page.StoredItems.Empty();
+		Page.StoredNestedItems.Empty();
+		Page.StoredNestedLoad = FXIUInventoryLoad();
+		Page.StoredStackSpace.Empty();
+		Page.StoredFreeSlotGroups.Empty();
+		Page.StoredFreeSlots = 0;
+		for (const FXIUInventorySlot* Slot : Slots)
+		{
+			if (UXIUItem* Item = Slot ? Slot->GetItemSafe() : nullptr)
+			{
+				FXIUItemDefault* Summary = Page.StoredItems.FindByPredicate([Item](const FXIUItemDefault& Stored) { return Stored.ItemDefinition == Item->GetItemDefinition(); });
+				if (Summary) Summary->Count += Item->GetCount();
+				else Page.StoredItems.Add(FXIUItemDefault(Item->GetItemDefinition(), Item->GetCount()));
+
+				// the contents of containers stay in the nested counts and in the load, so limits hold while stored
+				if (const UXIUContainerItem* Container = Cast<UXIUContainerItem>(Item))
+				{
+					for (const TPair<const UXIUItemDefinition*, int32>& Aggregate : Container->AggregateCounts)
+					{
+						FXIUItemDefault* Nested = Page.StoredNestedItems.FindByPredicate([&Aggregate](const FXIUItemDefault& Stored) { return Stored.ItemDefinition == Aggregate.Key; });
+						if (Nested) Nested->Count += Aggregate.Value;
+						else Page.StoredNestedItems.Add(FXIUItemDefault(const_cast<UXIUItemDefinition*>(Aggregate.Key), Aggregate.Value));
+					}
+					Page.StoredNestedLoad += Container->ContentLoad;
+				}
+
+				// only stacks PlanPlacement could top up
+				const int32 Space = Item->GetMaxCount() - Item->GetCount();
+				if (Space > 0 && !Slot->IsLocked())
+				{
+					FXIUItemDefault* StackSpace = Page.StoredStackSpace.FindByPredicate([Item](const FXIUItemDefault& Stored) { return Stored.ItemDefinition == Item->GetItemDefinition(); });
+					if (StackSpace) StackSpace->Count += Space;
+					else Page.StoredStackSpace.Add(FXIUItemDefault(Item->GetItemDefinition(), Space));
+				}
+			}
+			else if (!Slot || !Slot->IsLocked())
+			{
+				Page.StoredFreeSlots++;
+				FXIUInventoryStoredFreeSlots* FreeSlots = Slot ? Page.StoredFreeSlotGroups.FindByPredicate([Slot](const FXIUInventoryStoredFreeSlots& Stored) { return Stored.Group.HasSameFilter(*Slot); })
+					: Page.StoredFreeSlotGroups.FindByPredicate([](const FXIUInventoryStoredFreeSlots& Stored) { return !Stored.Group.Filter && !Stored.Group.HasTagFilter(); });
+				if (!FreeSlots)
+				{
+					FreeSlots = &Page.StoredFreeSlotGroups.AddDefaulted_GetRef();
+					if (Slot)
+					{
+						FreeSlots->Group.Filter = Slot->GetFilter();
+						FreeSlots->Group.RequiredTags = Slot->GetRequiredTags();
+						FreeSlots->Group.BlockedTags = Slot->GetBlockedTags();
+					}
+				}
+				FreeSlots->Count++;
+			}
+		}
+	}
+
+	// release items without broadcasting: the content of the slots did not change, it just is not in memory anymore
+	for (FXIUInventorySlot& Slot : Entries)
+	{
+		if (Slot.Index < FirstSlot || Slot.Index >= LastSlot) continue;
+		
+		UXIUItem* OldItem;
+		if (Slot.Clear(OldItem))
+		{
+			if (UXIUContainerItem* Container = Cast<UXIUContainerItem>(OldItem)) DetachContainer(Container, true);
+			ClearItemOwner(OldItem, Slot.GetIndex());
+			OwnerComponent->UnregisterReplicatedObject(OldItem, true);
+		}
+	}
+	Entries.RemoveAll([FirstSlot, LastSlot](const FXIUInventorySlot& Slot) { return Slot.Index >= FirstSlot && Slot.Index < LastSlot; });
+	MarkArrayDirty();
+	SlotLayoutVersion++;
+
+	Page.State = bDefaultPage ? EXIUInventoryPageState::Unallocated : EXIUInventoryPageState::Stored;
+	return true;
+}
+
+int32 FXIUInventoryList::PageOutColdPages(const double ColdTime)
+{
+	if (!IsPaged()) return 0;
+	if (PageStore) PageStore->ReleaseWrittenPages();
+	
+	const double Threshold = FPlatformTime::Seconds() - ColdTime;
+	int32 PagedOut = 0;
+	for (int32 PageIndex = 0; PageIndex < Pages.Num(); PageIndex++)
+	{
+		// pages someone is looking at are never cold
+		if (IsPageReplicated(PageIndex)) continue;
+		
+		if (Pages[PageIndex].State == EXIUInventoryPageState::Resident && Pages[PageIndex].LastAccessTime < Threshold)
+		{
+			if (PageOut(PageIndex)) PagedOut++;
+		}
+	}
+	return PagedOut;
+}
+
+void FXIUInventoryList::PageInAll()
+{
+	PageInWhere([](const FXIUInventoryPage&) { return true; });
+}
+
+void FXIUInventoryList::PageInDefinition(const UXIUItemDefinition* ItemDefinition)
+{
+	PageInWhere([ItemDefinition](const FXIUInventoryPage& Page)
+	{
+		return Page.StoredItems.ContainsByPredicate([ItemDefinition](const FXIUItemDefault& Stored) { return Stored.ItemDefinition == ItemDefinition; });
+	});
+}
+
+void FXIUInventoryList::PageInWhere(TFunctionRef<bool(const FXIUInventoryPage&)> Predicate)
+{
+	TArray<int32, TInlineAllocator<8>> PageIndexes;
+	for (int32 PageIndex = 0; PageIndex < Pages.Num(); PageIndex++)
+	{
+		if (Pages[PageIndex].State == EXIUInventoryPageState::Stored && Predicate(Pages[PageIndex]))
+		{
+			PageIndexes.Add(PageIndex);
+		}
+	}
+	if (PageIndexes.Num() == 0) return;
+
+	// every read is started before waiting on the first one
+	if (PageStore)
+	{
+		for (const int32 PageIndex : PageIndexes) PageStore->PrefetchPage(PageIndex);
+	}
+	for (const int32 PageIndex : PageIndexes) PageIn(PageIndex);
+}
+
+bool FXIUInventoryList::IsPageReplicated(const int32 PageIndex) const
+{
+	if (!bWindowedReplication) return true;
+	
+	const int32 FirstSlot = PageIndex * SlotsPerPage;
+	return FirstSlot < WindowLastSlot && FirstSlot + SlotsPerPage > WindowFirstSlot;
+}
+
+int32 FXIUInventoryList::CountStoredItemsByDefinition(const UXIUItemDefinition* ItemDefinition) const
+{
+	int32 Count = 0;
+	for (const FXIUInventoryPage& Page : Pages)
+	{
+		if (Page.State != EXIUInventoryPageState::Stored) continue;
+		for (const FXIUItemDefault& Stored : Page.StoredItems)
+		{
+			if (Stored.ItemDefinition == ItemDefinition) Count += Stored.Count;
+		}
+	}
+	return Count;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Memory */
+
+SIZE_T FXIUInventoryList::GetAllocatedSize() const
+{
+	SIZE_T Size = Entries.GetAllocatedSize();
+	Size += PendingChangeMessages.GetAllocatedSize() + SlotToEntryCache.GetAllocatedSize();
+	Size += FilterCompatibility.GetAllocatedSize() + FilterGroups.GetAllocatedSize() + FilterTags.GetAllocatedSize();
+	Size += DefinitionTagMasks.GetAllocatedSize() + EntryFilterGroups.GetAllocatedSize() + ResolvedPalette.GetAllocatedSize();
+	Size += TrackedSlotCounts.GetAllocatedSize() + TrackedSlotLoads.GetAllocatedSize() + SlotGenerations.GetAllocatedSize();
+	Size += TrackedSlotDefinitions.GetAllocatedSize() + NestedItemCounts.GetAllocatedSize();
+	Size += Pages.GetAllocatedSize();
+	for (const FXIUInventoryPage& Page : Pages)
+	{
+		Size += Page.StoredItems.GetAllocatedSize() + Page.StoredNestedItems.GetAllocatedSize();
+		Size += Page.StoredStackSpace.GetAllocatedSize() + Page.StoredFreeSlotGroups.GetAllocatedSize();
+	}
+	return Size;
+}
+
+void FXIUInventoryList::GatherMemoryReport(FXIUInventoryMemoryReport& Report) const
+{
+	Report.SlotCount += GetSize();
+	Report.OccupiedSlotCount += GetOccupiedSlotCount();
+	Report.SlotBytes += GetAllocatedSize();
+	if (const TArray<FXIUInventorySlotSettings>* Palette = GetSettingsPalette())
+	{
+		Report.SettingsBytes += Palette->GetAllocatedSize();
+		for (const FXIUInventorySlotSettings& Settings : *Palette)
+		{
+			Report.SettingsBytes += (Settings.RequiredTags.Num() + Settings.BlockedTags.Num()) * sizeof(FGameplayTag);
+		}
+	}
+
+	for (const FXIUInventorySlot& Slot : Entries)
+	{
+		UXIUItem* Item = Slot.GetItem();
+		if (!Item) continue;
+
+		Report.ItemCount++;
+		if (ShouldReplicateSlot(Slot.GetIndex())) Report.ReplicatedItemCount++;
+		Report.ItemBytes += Item->GetClass()->GetStructureSize() + Item->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+		Report.DelegateBytes += Item->ItemCountChangedDelegate.GetAllocatedSize() + Item->ItemInitializedDelegate.GetAllocatedSize();
+		Report.DelegateBindingCount += Item->ItemCountChangedDelegate.GetAllObjects().Num() + Item->ItemInitializedDelegate.GetAllObjects().Num();
+		if (const UXIUContainerItem* Container = Cast<UXIUContainerItem>(Item)) Container->Contents.GatherMemoryReport(Report);
+	}
+}
 
-
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Net stats */
+
+uint64 FXIUInventoryList::GetReplicatedBytes(const int32 Seconds) const
+{
+	const int64 Now = FMath::FloorToInt64(FPlatformTime::Seconds());
+	const int64 Oldest = Now - FMath::Clamp(Seconds, 1, ReplicatedBytesWindow) + 1;
+	uint64 Bytes = 0;
+	for (int32 Bucket = 0; Bucket < ReplicatedBytesWindow; Bucket++)
+	{
+		if (ReplicatedBytesSeconds[Bucket] >= Oldest && ReplicatedBytesSeconds[Bucket] <= Now) Bytes += ReplicatedBytes[Bucket];
+	}
+
+	for (const FXIUInventorySlot& Slot : Entries)
+	{
+		if (const UXIUContainerItem* Container = Cast<UXIUContainerItem>(Slot.GetItem())) Bytes += Container->Contents.GetReplicatedBytes(Seconds);
+	}
+	return Bytes;
+}
+
+void FXIUInventoryList::RecordReplicatedBytes(const uint64 Bytes)
+{
+	if (Bytes == 0) return;
+
+	const int64 Second = FMath::FloorToInt64(FPlatformTime::Seconds());
+	const int32 Bucket = Second % ReplicatedBytesWindow;
+	if (ReplicatedBytesSeconds[Bucket] != Second)
+	{
+		ReplicatedBytesSeconds[Bucket] = Second;
+		ReplicatedBytes[Bucket] = 0;
+	}
+	ReplicatedBytes[Bucket] += Bytes;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Windowed replication */
+
+void FXIUInventoryList::EnableWindowedReplication()
+{
+	bWindowedReplication = true;
+	WindowFirstSlot = 0;
+	WindowLastSlot = 0;
+}
+
+void FXIUInventoryList::SetReplicationWindow(const int32 FirstSlot, const int32 LastSlot)
+{
+	check(CanManipulateInventory());
+	if (!bWindowedReplication || (FirstSlot == WindowFirstSlot && LastSlot == WindowLastSlot)) return;
+	WakeNetDormancy();
+
+	const int32 OldFirstSlot = WindowFirstSlot;
+	const int32 OldLastSlot = WindowLastSlot;
+	WindowFirstSlot = FirstSlot;
+	WindowLastSlot = LastSlot;
+
+	// visible pages need to be resident (items of loaded pages get registered, since the window is already set).
+	// The pages right outside the window get prefetched, so that scrolling to them does not wait on disk
+	if (IsPaged())
+	{
+		const int32 FirstPage = GetPageIndex(FirstSlot);
+		const int32 LastPage = GetPageIndex(FMath::Max(LastSlot - 1, FirstSlot));
+		for (int32 PageIndex = FirstPage; PageIndex <= LastPage; PageIndex++)
+		{
+			if (GetPageState(PageIndex) == EXIUInventoryPageState::Stored) PageIn(PageIndex);
+			TouchPage(PageIndex);
+		}
+		if (PageStore)
+		{
+			if (GetPageState(FirstPage - 1) == EXIUInventoryPageState::Stored) PageStore->PrefetchPage(FirstPage - 1);
+			if (GetPageState(LastPage + 1) == EXIUInventoryPageState::Stored) PageStore->PrefetchPage(LastPage + 1);
+		}
+	}
+
+	// items of slots which left the window stop replicating (without being destroyed)
+	for (int32 SlotIndex = OldFirstSlot; SlotIndex < OldLastSlot; SlotIndex++)
+	{
+		if (ShouldReplicateSlot(SlotIndex)) continue;
+		if (const FXIUInventorySlot* Slot = FindSlot(SlotIndex))
+		{
+			if (UXIUItem* Item = Slot->GetItem()) OwnerComponent->UnregisterReplicatedObject(Item, false);
+		}
+	}
+
+	// items of slots which entered the window start replicating
+	for (int32 SlotIndex = FirstSlot; SlotIndex < LastSlot; SlotIndex++)
+	{
+		if (SlotIndex >= OldFirstSlot && SlotIndex < OldLastSlot) continue;
+		if (const FXIUInventorySlot* Slot = FindSlot(SlotIndex))
+		{
+			if (UXIUItem* Item = Slot->GetItem()) RegisterSlotItem(*Slot, Item);
+		}
+	}
+
+	// makes the delta serialization run again, so that ShouldWriteFastArrayItem picks up the new window
+	MarkArrayDirty();
+}
+
+void FXIUInventoryList::RegisterSlotItem(const FXIUInventorySlot& Slot, UXIUItem* Item)
+{
+	if (Item && ShouldReplicateSlot(Slot.GetIndex()))
+	{
+		OwnerComponent->RegisterReplicatedObject(Item);
+	}
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
 
 
 
@@ -491,6 +2484,15 @@ UXIUInventoryComponent::UXIUInventoryComponent(const FObjectInitializer& ObjectI
 {
 	InventorySize = 1;
 	bManualInitialization = false;
+	bPagedStorage = false;
+	SlotsPerPage = 64;
+	ColdPageTime = 60.f;
+	bWindowedReplication = false;
+	ReplicationPageSize = 64;
+	MaxWeight = 0.f;
+	MaxVolume = 0.f;
+	bJournal = false;
+	JournalCapacity = 4096;
 }
 
 
@@ -506,6 +2508,32 @@ void UXIUInventoryComponent::BeginPlay()
 
 	if (GetOwner()->HasAuthority())
 	{
+		OwnerNetDormancy = GetOwner()->FindComponentByClass<UXIUNetDormancyComponent>();
+		Capacity.MaxLoad = FXIUInventoryLoad::FromUnits(MaxWeight, MaxVolume);
+		
+		if (bPagedStorage)
+		{
+			// without windowed replication every page is replicated, so none can leave memory
+			if (ColdPageTime >= 0.f && !bWindowedReplication)
+			{
+				UE_LOG(LogTemp, Warning, TEXT("UXIUInventoryComponent::BeginPlay -> [%s] needs windowed replication to store cold pages, every page will stay in memory"), *GetName())
+			}
+			const TSharedPtr<FXIUInventoryPageStore> PageStore = ColdPageTime >= 0.f && bWindowedReplication ? MakeShared<FXIUInventoryPageStore>() : nullptr;
+			Inventory.EnablePagedStorage(FMath::Max(SlotsPerPage, 1), PageStore);
+			if (PageStore)
+			{
+				const float CheckInterval = FMath::Max(ColdPageTime * 0.5f, 1.f);
+				GetWorld()->GetTimerManager().SetTimer(ColdPageTimerHandle, this, &ThisClass::PageOutColdPages, CheckInterval, true);
+			}
+		}
+		
+		if (bWindowedReplication)
+		{
+			// there is a single window, set by the owner: other connections would get slots they are not looking at
+			DOREPLIFETIME_CHANGE_CONDITION(ThisClass, Inventory, COND_OwnerOnly);
+			Inventory.EnableWindowedReplication();
+		}
+		
 		if (bManualInitialization)
 		{
 			ManualInitialization();
@@ -514,17 +2542,66 @@ void UXIUInventoryComponent::BeginPlay()
 		{
 			Inventory.InitInventory(InventorySize);
 		}
+		UpdatePagingInfo();
+		if (bWindowedReplication)
+		{
+			// until the client tells us what it is looking at, we assume the first page
+			ApplyVisibleSlotRange(0, GetReplicationPageSize());
+		}
 		AddDefaultItems();
 		SetInventoryInitialized(true);
+		if (bJournal)
+		{
+			StartJournal(FString());
+		}
+	}
+
+	if (UXIUInventoryWorldSubsystem* InventorySubsystem = UWorld::GetSubsystem<UXIUInventoryWorldSubsystem>(GetWorld()))
+	{
+		InventorySubsystem->RegisterInventory(this);
+	}
+}
+
+void UXIUInventoryComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UXIUInventoryWorldSubsystem* InventorySubsystem = UWorld::GetSubsystem<UXIUInventoryWorldSubsystem>(GetWorld()))
+	{
+		InventorySubsystem->UnregisterInventory(this);
 	}
+	StopJournal();
+	
+	Super::EndPlay(EndPlayReason);
 }
 
 void UXIUInventoryComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	DOREPLIFETIME(ThisClass, Inventory);
+	// owner only when windowed replication is enabled (see BeginPlay)
+	DOREPLIFETIME_CONDITION(ThisClass, Inventory, COND_Dynamic);
+	DOREPLIFETIME(ThisClass, RestoreCount);
 	DOREPLIFETIME(ThisClass, bInventoryInitialized);
+	DOREPLIFETIME(ThisClass, PagingInfo);
+	DOREPLIFETIME(ThisClass, PageSummaries);
+	DOREPLIFETIME(ThisClass, Capacity);
+	DOREPLIFETIME(ThisClass, SlotSettingsPalette);
+}
+
+void UXIUInventoryComponent::BeginDestroy()
+{
+	Inventory.ClearItemOwners();
+	
+	Super::BeginDestroy();
+}
+
+void UXIUInventoryComponent::GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize)
+{
+	Super::GetResourceSizeEx(CumulativeResourceSize);
+
+	// items are objects of their own, so they are only part of the estimated total
+	const FXIUInventoryMemoryReport Report = GetMemoryReport();
+	const bool bTotal = CumulativeResourceSize.GetResourceSizeMode() == EResourceSizeMode::EstimatedTotal;
+	CumulativeResourceSize.AddDedicatedSystemMemoryBytes(bTotal ? Report.GetTotalBytes() : Report.SlotBytes + Report.SettingsBytes);
 }
 
 
@@ -549,112 +2626,304 @@ void UXIUInventoryComponent::OnRep_InventoryInitialized()
 {
 	if (bInventoryInitialized)
 	{
+		bInitializedBroadcast = true;
 		BP_OnInventoryInitialized();
 		InventoryInitializedDelegate.Broadcast();
 	}
 }
 
+void UXIUInventoryComponent::OnRep_RestoreCount()
+{
+	// on the first replication the restored slots are the initial ones, and bInventoryInitialized broadcasts
+	const bool bRestored = IsRestoringSnapshot();
+	AppliedRestoreCount = RestoreCount;
+	if (bRestored) OnRep_InventoryInitialized();
+}
+
 void UXIUInventoryComponent::BroadcastInventoryChanged(const FXIUInventorySlotChangeMessage& Message)
 {
 	BP_OnInventoryChanged();
 	InventoryChangedDelegate.Broadcast(Message);
 }
 
-void UXIUInventoryComponent::BindItemCountChangedDelegate(UXIUItem* InItem)
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void UXIUInventoryComponent::ManualInitialization()
+{
+	BP_OnManualInitialization();
+	ManualInitializationDelegate.Broadcast();
+	// to be implemented in child classes
+}
+
+void UXIUInventoryComponent::AddSlot(const FXIUInventorySlotSettings& SlotSettings)
+{
+	if (GetOwner() && GetOwner()->HasAuthority())
+	{
+		Inventory.AddSlot(SlotSettings);
+		UpdatePagingInfo();
+	}
+}
+
+void UXIUInventoryComponent::OnRep_SlotSettingsPalette()
 {
-	InItem->ItemCountChangedDelegate.AddUniqueDynamic(this, &ThisClass::OnItemCountChanged);
+	Inventory.OnSettingsPaletteReplicated();
 }
 
-void UXIUInventoryComponent::UnBindItemCountChangedDelegate(UXIUItem* InItem)
+int32 UXIUInventoryComponent::GetInventorySize() const
 {
-	InItem->ItemCountChangedDelegate.RemoveDynamic(this, &ThisClass::OnItemCountChanged);
+	return Inventory.GetSize();
 }
 
-void UXIUInventoryComponent::OnItemCountChanged(const FXIUItemCountChangeMessage& Change)
+void UXIUInventoryComponent::UpdatePagingInfo()
 {
-	checkf(Change.Item, TEXT("Item is null, which means something went really wrong"))
+	if (!Inventory.IsPaged()) return;
 	
-	FXIUInventorySlot ItemSlot;
-	for (const FXIUInventorySlot& Slot : Inventory.GetInventory())
+	PagingInfo.SlotsPerPage = Inventory.GetSlotsPerPage();
+	PagingInfo.SlotCount = Inventory.GetSize();
+}
+
+void UXIUInventoryComponent::OnRep_PagingInfo()
+{
+	Inventory.SetPagingInfo(PagingInfo.SlotsPerPage, PagingInfo.SlotCount);
+}
+
+void UXIUInventoryComponent::PageOutColdPages()
+{
+	Inventory.PageOutColdPages(ColdPageTime);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Net Dormancy */
+
+void UXIUInventoryComponent::WakeOwnerNetDormancy()
+{
+	if (OwnerNetDormancy)
 	{
-		if (Slot.GetItem() == Change.Item)
-		{
-			ItemSlot = Slot;
-			break;
-		}
+		OwnerNetDormancy->Wake();
+		return;
+	}
+	if (GetOwner()) GetOwner()->FlushNetDormancy();
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Windowed replication */
+
+void UXIUInventoryComponent::SetVisibleSlotRange(const int32 FirstSlot, const int32 NumSlots)
+{
+	if (!GetOwner()) return;
+
+	if (GetOwner()->HasAuthority())
+	{
+		ApplyVisibleSlotRange(FirstSlot, NumSlots);
+	}
+	else if (!GetOwner()->GetNetConnection())
+	{
+		UE_LOG(LogTemp, Error, TEXT("UXIUInventoryComponent::SetVisibleSlotRange -> [%s] is not owned by this client, only the owner can set the replication window"), *GetName())
+	}
+	else
+	{
+		ServerSetVisibleSlotRangeRPC(FirstSlot, NumSlots);
 	}
+}
+
+void UXIUInventoryComponent::SetVisiblePage(const int32 PageIndex)
+{
+	const int32 PageSize = GetReplicationPageSize();
+	SetVisibleSlotRange(PageIndex * PageSize, PageSize);
+}
+
+void UXIUInventoryComponent::ServerSetVisibleSlotRangeRPC_Implementation(const int32 FirstSlot, const int32 NumSlots)
+{
+	ApplyVisibleSlotRange(FirstSlot, NumSlots);
+}
 
+void UXIUInventoryComponent::ApplyVisibleSlotRange(const int32 FirstSlot, const int32 NumSlots)
+{
+	if (!Inventory.IsWindowedReplication()) return;
 	
-	if (ItemSlot.GetItem())
+	// the window is aligned to pages, and extended by one page on each side to prefetch while scrolling
+	const int32 PageSize = GetReplicationPageSize();
+	const int32 Size = Inventory.GetSize();
+	const int32 First = FMath::Clamp(FirstSlot, 0, Size);
+	const int32 Last = FMath::Clamp(FirstSlot + FMath::Max(NumSlots, 1), First, Size);
+	const int32 FirstPage = FMath::Max(First / PageSize - 1, 0);
+	const int32 LastPage = FMath::Max(Last - 1, 0) / PageSize + 1;
+	Inventory.SetReplicationWindow(FirstPage * PageSize, FMath::Min((LastPage + 1) * PageSize, Size));
+}
+
+int32 UXIUInventoryComponent::GetReplicationPageSize() const
+{
+	return FMath::Max(Inventory.IsPaged() ? Inventory.GetSlotsPerPage() : ReplicationPageSize, 1);
+}
+
+FXIUInventoryPageSummary UXIUInventoryComponent::GetPageSummary(const int32 PageIndex) const
+{
+	return PageSummaries.IsValidIndex(PageIndex) ? PageSummaries[PageIndex] : FXIUInventoryPageSummary();
+}
+
+void UXIUInventoryComponent::UpdatePageSummary(const int32 SlotIndex, const int32 OccupiedDelta, const int32 CountDelta)
+{
+	const int32 PageIndex = SlotIndex / GetReplicationPageSize();
+	if (!PageSummaries.IsValidIndex(PageIndex))
 	{
-		bool bItemChanged = Change.Item->GetCount() == 0;
-		if (GetOwner() && GetOwner()->HasAuthority())
-		{
-			Inventory.RegisterSlotChange(ItemSlot, Change.OldCount, Change.Item->GetCount(), bItemChanged, bItemChanged? Change.Item : nullptr);
-		}
-		else
-		{
-			TArray<int32> ChangedIndex = { ItemSlot.GetIndex() };
-			Inventory.PostReplicatedChange(ChangedIndex, Inventory.GetSize());
-		}
+		PageSummaries.SetNum(PageIndex + 1);
+	}
+	
+	FXIUInventoryPageSummary& Summary = PageSummaries[PageIndex];
+	Summary.OccupiedSlots = FMath::Clamp<int32>(Summary.OccupiedSlots + OccupiedDelta, 0, MAX_uint16);
+	Summary.TotalCount += CountDelta;
+}
+
+void UXIUInventoryComponent::ResetPageSummaries()
+{
+	PageSummaries.Reset();
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Capacity */
+
+void UXIUInventoryComponent::SetCapacityLimits(const float NewMaxWeight, const float NewMaxVolume)
+{
+	if (GetOwner() && GetOwner()->HasAuthority())
+	{
+		MaxWeight = FMath::Max(NewMaxWeight, 0.f);
+		MaxVolume = FMath::Max(NewMaxVolume, 0.f);
+		Capacity.MaxLoad = FXIUInventoryLoad::FromUnits(MaxWeight, MaxVolume);
+		WakeOwnerNetDormancy();
 	}
 }
 
-void UXIUInventoryComponent::OnItemInitialized(UXIUItem* InItem)
+int32 UXIUInventoryComponent::GetCountWithinCapacity(const FXIUInventoryLoad& UnitLoad, const int32 Count, const FXIUInventoryLoad& FreedLoad) const
 {
-	checkf(InItem, TEXT("Item is null, which means something went really wrong"))
+	if (Count <= 0) return Count;
 	
-	FXIUInventorySlot ItemSlot;
-	for (const FXIUInventorySlot& Slot : Inventory.GetInventory())
+	int64 AllowedCount = Count;
+	const FXIUInventoryLoad& MaxLoad = Capacity.MaxLoad;
+	const FXIUInventoryLoad FreeLoad = MaxLoad - Capacity.CurrentLoad + FreedLoad;
+	if (MaxLoad.Weight > 0 && UnitLoad.Weight > 0)
 	{
-		if (Slot.GetItem() == InItem)
-		{
-			ItemSlot = Slot;
-			break;
-		}
+		AllowedCount = FMath::Min(AllowedCount, FMath::Max<int64>(FreeLoad.Weight, 0) / UnitLoad.Weight);
 	}
+	if (MaxLoad.Volume > 0 && UnitLoad.Volume > 0)
+	{
+		AllowedCount = FMath::Min(AllowedCount, FMath::Max<int64>(FreeLoad.Volume, 0) / UnitLoad.Volume);
+	}
+	return static_cast<int32>(AllowedCount);
+}
+
+void UXIUInventoryComponent::UpdateLoad(const FXIUInventoryLoad& LoadDelta)
+{
+	Capacity.CurrentLoad += LoadDelta;
+}
+
+void UXIUInventoryComponent::ResetLoad()
+{
+	Capacity.CurrentLoad = FXIUInventoryLoad();
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Journal */
+
+bool UXIUInventoryComponent::StartJournal(const FString& Path)
+{
+	if (!GetOwner() || !GetOwner()->HasAuthority()) return false;
+	StopJournal();
+
+	const FString JournalPath = !Path.IsEmpty() ? Path : FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("XyloInventoryUtil"), TEXT("Journal"),
+		FString::Printf(TEXT("%s_%s_%s.xiujournal"), *GetOwner()->GetName(), *GetName(), *FDateTime::Now().ToString()));
 	
-	if (ItemSlot.GetItem())
+	// the journal only makes sense on top of the state it started from
+	TArray<uint8> Snapshot;
+	if (!SaveSnapshot(Snapshot) || !FFileHelper::SaveArrayToFile(Snapshot, *(JournalPath + TEXT(".snapshot"))))
 	{
-		if (GetOwner() && GetOwner()->HasAuthority())
-		{
-			Inventory.RegisterSlotChange(ItemSlot, 0, InItem->GetCount(), true, nullptr);
-		}
-		else
-		{
-			TArray<int32> ChangedIndex = { ItemSlot.GetIndex() };
-			Inventory.PostReplicatedChange(ChangedIndex, Inventory.GetSize());
-		}
+		UE_LOG(LogTemp, Error, TEXT("UXIUInventoryComponent::StartJournal -> Could not write the snapshot of [%s]"), *JournalPath)
+		return false;
 	}
+	
+	const TSharedPtr<FXIUInventoryJournal> NewJournal = MakeShared<FXIUInventoryJournal>(JournalPath, JournalCapacity);
+	if (!NewJournal->Start()) return false;
+	
+	Journal = NewJournal;
+	Inventory.SetJournal(Journal);
+	return true;
 }
 
-void UXIUInventoryComponent::BindItemInitializedDelegate(UXIUItem* InItem)
+void UXIUInventoryComponent::StopJournal()
 {
-	InItem->ItemInitializedDelegate.AddUniqueDynamic(this, &ThisClass::OnItemInitialized);
+	if (!Journal) return;
+	
+	Inventory.SetJournal(nullptr);
+	Journal->Shutdown();
+	Journal.Reset();
 }
 
-void UXIUInventoryComponent::UnBindItemInitializedDelegate(UXIUItem* InItem)
+bool UXIUInventoryComponent::ReplayJournal(const FString& Path)
 {
-	InItem->ItemInitializedDelegate.RemoveDynamic(this, &ThisClass::OnItemInitialized);
+	if (!GetOwner() || !GetOwner()->HasAuthority()) return false;
+	
+	StopJournal();
+	return FXIUInventoryJournal::ReplayFromFile(this, Path);
 }
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-void UXIUInventoryComponent::ManualInitialization()
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Diagnostics */
+
+FXIUInventoryMemoryReport UXIUInventoryComponent::GetMemoryReport() const
 {
-	BP_OnManualInitialization();
-	ManualInitializationDelegate.Broadcast();
-	// to be implemented in child classes
+	FXIUInventoryMemoryReport Report;
+	Inventory.GatherMemoryReport(Report);
+	Report.SlotBytes += PageSummaries.GetAllocatedSize();
+	return Report;
 }
 
-void UXIUInventoryComponent::AddSlot(const FXIUInventorySlotSettings& SlotSettings)
+uint64 UXIUInventoryComponent::GetReplicatedBytes(const int32 Seconds) const
 {
-	if (GetOwner() && GetOwner()->HasAuthority())
+	return Inventory.GetReplicatedBytes(Seconds);
+}
+
+namespace XIUInventoryDiagnostics
+{
+	static void DumpList(FOutputDevice& Ar, const FXIUInventoryList& List, const FString& Indent)
 	{
-		Inventory.AddSlot(SlotSettings);
+		for (const FXIUInventorySlot& Slot : List.GetInventory())
+		{
+			if (Slot.IsEmpty() && Slot.GetSettingsIndex() == 0) continue;
+
+			Ar.Logf(TEXT("%s[SLOT %i] %s%s%s"), *Indent, Slot.GetIndex(), *Slot.GetDebugString(),
+				Slot.IsLocked() ? TEXT(" (locked)") : TEXT(""),
+				Slot.GetFilter() ? *FString::Printf(TEXT(" (filter %s)"), *Slot.GetFilter()->GetName()) : TEXT(""));
+			if (const UXIUContainerItem* Container = Cast<UXIUContainerItem>(Slot.GetItemSafe()))
+			{
+				DumpList(Ar, Container->GetContents(), Indent + TEXT("    "));
+			}
+		}
+	}
+}
+
+void UXIUInventoryComponent::DumpInventory(FOutputDevice& Ar) const
+{
+	const FXIUInventoryMemoryReport Report = GetMemoryReport();
+	Ar.Logf(TEXT("%s.%s: %i/%i slots occupied, %i items (%i replicated), %i delegate bindings, generation %u"),
+		*GetNameSafe(GetOwner()), *GetName(), Report.OccupiedSlotCount, Report.SlotCount, Report.ItemCount,
+		Report.ReplicatedItemCount, Report.DelegateBindingCount, Inventory.GetGeneration());
+	Ar.Logf(TEXT("  Memory: %lld bytes (slots %lld, items %lld, delegates %lld, settings %lld)"),
+		Report.GetTotalBytes(), Report.SlotBytes, Report.ItemBytes, Report.DelegateBytes, Report.SettingsBytes);
+	Ar.Logf(TEXT("  Replicated: %llu bytes in the last %i seconds"), GetReplicatedBytes(FXIUInventoryList::ReplicatedBytesWindow), FXIUInventoryList::ReplicatedBytesWindow);
+	if (Inventory.IsPaged())
+	{
+		Ar.Logf(TEXT("  Paged: %i slots per page (only resident pages are listed)"), Inventory.GetSlotsPerPage());
 	}
+	XIUInventoryDiagnostics::DumpList(Ar, Inventory, TEXT("  "));
 }
 
+/*--------------------------------------------------------------------------------------------------------------------*/
+
 void UXIUInventoryComponent::InputAddDefaultItems()
 {
 	if (!GetOwner()) return;
@@ -676,12 +2945,28 @@ void UXIUInventoryComponent::ServerAddDefaultItemsRPC_Implementation()
 
 void UXIUInventoryComponent::AddDefaultItems()
 {
-	for (const FXIUItemDefault DefaultItem : DefaultItems)
+	AddItemDefaults(DefaultItems);
+	if (LootTable)
 	{
-		AddItemDefault(DefaultItem);
+		AddLootTableItems(LootTable, LootSeed != 0 ? LootSeed : FMath::Rand());
 	}
 }
 
+void UXIUInventoryComponent::AddLootTableItems(UXIULootTable* InLootTable, const int32 Seed)
+{
+	if (!InLootTable || !GetOwner() || !GetOwner()->HasAuthority()) return;
+
+	// the loot table is kept alive by the lambda until the result is applied
+	TStrongObjectPtr<UXIULootTable> KeepAlive(InLootTable);
+	InLootTable->EvaluateAsync(Seed).Next([WeakThis = TWeakObjectPtr<ThisClass>(this), KeepAlive = MoveTemp(KeepAlive)](TArray<FXIUItemDefault> Items) mutable
+	{
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, KeepAlive = MoveTemp(KeepAlive), Items = MoveTemp(Items)]()
+		{
+			if (ThisClass* Inventory = WeakThis.Get()) Inventory->AddItemDefaults(Items);
+		});
+	});
+}
+
 void UXIUInventoryComponent::PrintItems()
 {
 	GEngine->AddOnScreenDebugMessage(-1, 1.f, FColor::Orange, FString::Printf(TEXT("Inventory Size: %i"), Inventory.GetSize()));
@@ -706,10 +2991,33 @@ void UXIUInventoryComponent::AddItemDefault(const FXIUItemDefault ItemDefault)
 	}
 }
 
+int32 UXIUInventoryComponent::AddItemDefaults(TConstArrayView<FXIUItemDefault> ItemDefaults)
+{
+	int32 NotAdded = 0;
+	if (GetOwner() && GetOwner()->HasAuthority())
+	{
+		FXIUInventoryChangeBatchScope ChangeBatch(Inventory);
+		TArray<UXIUItem*> AddedItems;
+		for (const FXIUItemDefault& ItemDefault : ItemDefaults)
+		{
+			if (!ItemDefault.ItemDefinition || ItemDefault.Count <= 0) continue;
+			AddedItems.Reset();
+			NotAdded += Inventory.AddItemDefault(ItemDefault, AddedItems);
+		}
+	}
+	return NotAdded;
+}
+
+int32 UXIUInventoryComponent::K2_AddItemDefaults(const TArray<FXIUItemDefault>& ItemDefaults)
+{
+	return AddItemDefaults(ItemDefaults);
+}
+
 void UXIUInventoryComponent::AddItem(UXIUItem* Item, int32 CountOverride)
 {
 	if (GetOwner() && GetOwner()->HasAuthority())
 	{
+		FXIUInventoryJournal::FSourceScope JournalSource(Journal.Get(), Item ? Item->GetOuter() : nullptr);
 		UXIUItem* AddedItem;
 		Inventory.AddItem(Item, CountOverride, true, true, AddedItem);
 	}
@@ -719,6 +3027,7 @@ void UXIUInventoryComponent::AddItemNoModify(UXIUItem* Item, int32 CountOverride
 {
 	if (GetOwner() && GetOwner()->HasAuthority())
 	{
+		FXIUInventoryJournal::FSourceScope JournalSource(Journal.Get(), Item ? Item->GetOuter() : nullptr);
 		UXIUItem* AddedItem;
 		Inventory.AddItem(Item, CountOverride, true, false, AddedItem);
 	}
@@ -739,7 +3048,7 @@ void UXIUInventoryComponent::TransferItemFromSlot(int32 SlotIndex, UXIUInventory
 {
 	if (GetOwner() && GetOwner()->HasAuthority())
 	{
-		if (UXIUItem* Item = Inventory.GetItemAtSlot(SlotIndex))
+		if (UXIUItem* Item = Inventory.LoadItemAtSlot(SlotIndex))
 		{
 			// we can just use add item since Inventory.AddItem already takes care of modifying Item count
 			OtherInventory->AddItem(Item);
@@ -749,10 +3058,11 @@ void UXIUInventoryComponent::TransferItemFromSlot(int32 SlotIndex, UXIUInventory
 
 AActor* UXIUInventoryComponent::DropItemAtSlot(const FTransform& DropTransform, const int32 SlotIndex, const int32 Count, const bool bFinishSpawning)
 {
+	XIU_INVENTORY_TRACE_OP(Drop);
 	if (!GetOwner() || !GetOwner()->HasAuthority() || Count == 0) return nullptr;
 
 	// Get item to drop
-	UXIUItem* ItemToDrop = GetItemAtSlot(SlotIndex);
+	UXIUItem* ItemToDrop = Inventory.LoadItemAtSlot(SlotIndex);
 	if (!ItemToDrop) return nullptr;
 	
 	// Get class of actor to spawn as drop
@@ -782,7 +3092,8 @@ AActor* UXIUInventoryComponent::DropItemAtSlot(const FTransform& DropTransform,
 
 	// if Count < 0 drop everything, else try to drop Count if we have enough
 	const int32 CountToDrop = Count > 0 ? FMath::Min(ItemToDrop->GetCount(), Count) : ItemToDrop->GetCount();
-	// Set Item in actor (we assume that all count will fit)
+	// the actor gets a copy: the item was created on clients through the channel of this inventory, and moving the
+	// object to the channel of another actor would not reach them intact
 	PickUpInterface->Execute_SetItem(DroppedItemActor, ItemToDrop, CountToDrop);
 	// Adjust the count in original item
 	ItemToDrop->ModifyCount(-CountToDrop);
@@ -799,21 +3110,115 @@ int32 UXIUInventoryComponent::ConsumeItemsByDefinition(UXIUItemDefinition* ItemD
 	return Inventory.ConsumeItemByDefinition(ItemDefinition, Count);
 }
 
-UXIUItem* UXIUInventoryComponent::GetFirstItem()
+int32 UXIUInventoryComponent::TryConsumeRecipe(TConstArrayView<FXIUItemDefault> Ingredients, const int32 Multiplier)
 {
-	for (const FXIUInventorySlot& Slot : Inventory.GetInventory())
+	if (!GetOwner() || !GetOwner()->HasAuthority()) return 0;
+	return Inventory.ConsumeRecipe(Ingredients, Multiplier);
+}
+
+int32 UXIUInventoryComponent::K2_TryConsumeRecipe(const TArray<FXIUItemDefault>& Ingredients, const int32 Multiplier)
+{
+	return TryConsumeRecipe(Ingredients, Multiplier);
+}
+
+void UXIUInventoryComponent::ExecuteCommands(TArrayView<FXIUInventoryCommand> Commands)
+{
+	XIU_INVENTORY_TRACE_OP(Command);
+	check(IsInGameThread());
+	
+	TArray<int32, TInlineAllocator<16>> Results;
+	Results.SetNumZeroed(Commands.Num());
+	if (GetOwner() && GetOwner()->HasAuthority())
 	{
-		if (!Slot.IsEmpty())
+		// listeners get the change messages once all the commands are applied
+		FXIUInventoryChangeBatchScope ChangeBatch(Inventory);
+		for (int32 CommandIndex = 0; CommandIndex < Commands.Num(); CommandIndex++)
 		{
-			return Slot.GetItem();
+			Results[CommandIndex] = ExecuteCommand(Commands[CommandIndex]);
 		}
 	}
-	return nullptr;
+
+	for (int32 CommandIndex = 0; CommandIndex < Commands.Num(); CommandIndex++)
+	{
+		if (Commands[CommandIndex].OnCompleted) Commands[CommandIndex].OnCompleted(Results[CommandIndex]);
+	}
+}
+
+int32 UXIUInventoryComponent::ExecuteCommand(const FXIUInventoryCommand& Command)
+{
+	switch (Command.Type)
+	{
+	case EXIUInventoryCommandType::Add:
+		{
+			if (!Command.ItemDefinition || Command.Count <= 0) return 0;
+			TArray<UXIUItem*> AddedItems;
+			return Command.Count - Inventory.AddItemDefault(FXIUItemDefault(Command.ItemDefinition, Command.Count), AddedItems);
+		}
+	case EXIUInventoryCommandType::Consume:
+		{
+			if (!Command.ItemDefinition || Command.Count <= 0) return 0;
+			return Inventory.ConsumeItemByDefinition(Command.ItemDefinition, Command.Count);
+		}
+	case EXIUInventoryCommandType::Move:
+		{
+			UXIUInventoryComponent* TargetInventory = Command.TargetInventory.Get();
+			if (!TargetInventory || TargetInventory == this) return 0;
+			if (!TargetInventory->GetOwner() || !TargetInventory->GetOwner()->HasAuthority()) return 0;
+			if (Command.SlotIndex < 0 || Command.SlotIndex >= Inventory.GetSize()) return 0;
+			
+			UXIUItem* Item = Inventory.LoadItemAtSlot(Command.SlotIndex);
+			if (!Item) return 0;
+			const int32 MoveCount = Command.Count > 0 ? FMath::Min(Command.Count, Item->GetCount()) : Item->GetCount();
+			FXIUInventoryJournal::FSourceScope JournalSource(TargetInventory->Journal.Get(), GetOwner());
+			UXIUItem* AddedItem;
+			return MoveCount - TargetInventory->Inventory.AddItem(Item, MoveCount, true, true, AddedItem);
+		}
+	default:
+		return 0;
+	}
+}
+
+UXIUItem* UXIUInventoryComponent::GetFirstItem()
+{
+	const int32 SlotIndex = Inventory.GetFirstOccupiedSlotIndex();
+	if (SlotIndex == INDEX_NONE) return nullptr;
+	
+	return Inventory.GetItemAtSlot(SlotIndex);
+}
+
+bool UXIUInventoryComponent::IsInventoryEmpty() const
+{
+	return Inventory.IsInventoryEmpty();
+}
+
+int32 UXIUInventoryComponent::GetOccupiedSlotCount() const
+{
+	return Inventory.GetOccupiedSlotCount();
+}
+
+int32 UXIUInventoryComponent::GetTotalItemCount() const
+{
+	return Inventory.GetTotalItemCount();
+}
+
+uint32 UXIUInventoryComponent::GetChangesSince(const uint32 Generation, TArray<int32>& OutSlots) const
+{
+	return Inventory.GetChangesSince(Generation, OutSlots);
+}
+
+int64 UXIUInventoryComponent::K2_GetChangesSince(const int64 Generation, TArray<int32>& OutSlots) const
+{
+	return GetChangesSince(static_cast<uint32>(FMath::Clamp<int64>(Generation, 0, MAX_uint32)), OutSlots);
+}
+
+int64 UXIUInventoryComponent::GetInventoryGeneration() const
+{
+	return Inventory.GetGeneration();
 }
 
 int32 UXIUInventoryComponent::CountItemsByDefinition(UXIUItemDefinition* ItemDefinition)
 {
-	int32 Count = 0;
+	int32 Count = Inventory.CountStoredItemsByDefinition(ItemDefinition) + Inventory.CountNestedItemsByDefinition(ItemDefinition);
 	for (const FXIUInventorySlot& Slot : Inventory.GetInventory())
 	{
 		if (UXIUItem* Item = Slot.GetItemSafe())
@@ -824,13 +3229,24 @@ int32 UXIUInventoryComponent::CountItemsByDefinition(UXIUItemDefinition* ItemDef
 	return Count;
 }
 
+void UXIUInventoryComponent::GatherItemCounts(TArray<TPair<const UXIUItemDefinition*, int32>>& OutItems) const
+{
+	Inventory.GatherItemCounts(OutItems);
+}
+
 bool UXIUInventoryComponent::CanInsertItem(UXIUItem* Item) const
 {
-	for (const FXIUInventorySlot& Slot : Inventory.GetInventory())
-	{
-		if (Slot.CanInsertItem(Item)) return true;
-	}
-	return false;
+	return Inventory.CanInsertItem(Item);
+}
+
+int32 UXIUInventoryComponent::GetInsertableCount(const UXIUItemDefinition* ItemDefinition, const int32 Desired) const
+{
+	return Inventory.GetInsertableCount(ItemDefinition, Desired);
+}
+
+int32 UXIUInventoryComponent::GetInsertableCountForItem(UXIUItem* Item, const int32 Desired) const
+{
+	return Inventory.GetInsertableCount(Item, Desired);
 }
 
 UXIUItem* UXIUInventoryComponent::GetItemAtSlot(const int32 SlotIndex)
@@ -838,3 +3254,30 @@ UXIUItem* UXIUInventoryComponent::GetItemAtSlot(const int32 SlotIndex)
 	return Inventory.GetItemAtSlot(SlotIndex);
 }
 
+bool UXIUInventoryComponent::SaveSnapshot(TArray<uint8>& OutData)
+{
+	FMemoryWriter Writer(OutData);
+	Inventory.SaveSnapshot(Writer);
+	return !Writer.IsError();
+}
+
+bool UXIUInventoryComponent::LoadSnapshot(TConstArrayView<uint8> Data)
+{
+	if (!GetOwner() || !GetOwner()->HasAuthority()) return false;
+
+	// slot changes of the restore are not broadcast, clients know about it through RestoreCount
+	FMemoryReaderView Reader(Data);
+	RestoreCount++;
+	if (!Inventory.LoadSnapshot(Reader))
+	{
+		// an invalid snapshot did not touch the inventory
+		AppliedRestoreCount = --RestoreCount;
+		return false;
+	}
+	AppliedRestoreCount = RestoreCount;
+	UpdatePagingInfo();
+
+	SetInventoryInitialized(true);
+	return true;
+}
+
@@ -0,0 +1,137 @@
+// Copyright XyloIsCoding 2024
+
+
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Inventory/XIUInventoryComponent.h"
+#include "UObject/UObjectIterator.h"
+
+
+/** Console commands reporting on every inventory of a world. Output goes to the console that ran them, so they
+ * can be used on a dedicated server */
+namespace XIUInventoryConsoleCommands
+{
+	/** Seconds used for the replicated bytes when no argument is given */
+	static constexpr int32 DefaultSeconds = 10;
+
+	static void GetInventories(const UWorld* World, TArray<UXIUInventoryComponent*>& OutInventories)
+	{
+		if (!World) return;
+		for (TObjectIterator<UXIUInventoryComponent> It; It; ++It)
+		{
+			if (It->GetWorld() == World && !It->IsTemplate()) OutInventories.Add(*It);
+		}
+	}
+
+	static int32 ParseInt(const TArray<FString>& Args, const int32 ArgIndex, const int32 Default)
+	{
+		return Args.IsValidIndex(ArgIndex) && Args[ArgIndex].IsNumeric() ? FCString::Atoi(*Args[ArgIndex]) : Default;
+	}
+
+	static void DumpInventory(const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+	{
+		if (Args.IsEmpty())
+		{
+			Ar.Log(TEXT("Usage: xiu.DumpInventory <actor name (or part of it)>"));
+			return;
+		}
+
+		TArray<UXIUInventoryComponent*> Inventories;
+		GetInventories(World, Inventories);
+		int32 Dumped = 0;
+		for (const UXIUInventoryComponent* Inventory : Inventories)
+		{
+			const AActor* Owner = Inventory->GetOwner();
+			if (!Owner || (!Owner->GetName().Contains(Args[0]) && !Owner->GetActorNameOrLabel().Contains(Args[0]))) continue;
+			Inventory->DumpInventory(Ar);
+			Dumped++;
+		}
+		if (Dumped == 0) Ar.Logf(TEXT("No inventory found on actors matching [%s]"), *Args[0]);
+	}
+
+	static void Stats(const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+	{
+		const int32 Seconds = FMath::Clamp(ParseInt(Args, 0, DefaultSeconds), 1, FXIUInventoryList::ReplicatedBytesWindow);
+
+		TArray<UXIUInventoryComponent*> Inventories;
+		GetInventories(World, Inventories);
+		FXIUInventoryMemoryReport Total;
+		uint64 ReplicatedBytes = 0;
+		for (const UXIUInventoryComponent* Inventory : Inventories)
+		{
+			const FXIUInventoryMemoryReport Report = Inventory->GetMemoryReport();
+			Total.SlotCount += Report.SlotCount;
+			Total.OccupiedSlotCount += Report.OccupiedSlotCount;
+			Total.ItemCount += Report.ItemCount;
+			Total.ReplicatedItemCount += Report.ReplicatedItemCount;
+			Total.DelegateBindingCount += Report.DelegateBindingCount;
+			Total.SlotBytes += Report.SlotBytes;
+			Total.ItemBytes += Report.ItemBytes;
+			Total.DelegateBytes += Report.DelegateBytes;
+			Total.SettingsBytes += Report.SettingsBytes;
+			ReplicatedBytes += Inventory->GetReplicatedBytes(Seconds);
+		}
+
+		Ar.Logf(TEXT("%i inventories: %i/%i slots occupied, %i items (%i replicated), %i delegate bindings"),
+			Inventories.Num(), Total.OccupiedSlotCount, Total.SlotCount, Total.ItemCount, Total.ReplicatedItemCount, Total.DelegateBindingCount);
+		Ar.Logf(TEXT("Memory: %lld bytes (slots %lld, items %lld, delegates %lld, settings %lld), interned slot settings %llu bytes"),
+			Total.GetTotalBytes(), Total.SlotBytes, Total.ItemBytes, Total.DelegateBytes, Total.SettingsBytes,
+			static_cast<uint64>(FXIUInventorySlotSettings::GetInternedAllocatedSize()));
+		Ar.Logf(TEXT("Replicated slot deltas: %llu bytes in the last %i seconds"), ReplicatedBytes, Seconds);
+		if (const UNetDriver* NetDriver = World ? World->GetNetDriver() : nullptr)
+		{
+			Ar.Logf(TEXT("Net driver: %u bytes/s out, %u bytes/s in"), NetDriver->OutBytesPerSecond, NetDriver->InBytesPerSecond);
+		}
+	}
+
+	static void TopContainers(const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+	{
+		const int32 Count = FMath::Max(ParseInt(Args, 0, 10), 1);
+		const int32 Seconds = FMath::Clamp(ParseInt(Args, 1, DefaultSeconds), 1, FXIUInventoryList::ReplicatedBytesWindow);
+
+		struct FEntry
+		{
+			const UXIUInventoryComponent* Inventory;
+			FXIUInventoryMemoryReport Report;
+			uint64 ReplicatedBytes;
+		};
+		TArray<UXIUInventoryComponent*> Inventories;
+		GetInventories(World, Inventories);
+		TArray<FEntry> Entries;
+		for (const UXIUInventoryComponent* Inventory : Inventories)
+		{
+			Entries.Add({ Inventory, Inventory->GetMemoryReport(), Inventory->GetReplicatedBytes(Seconds) });
+		}
+		// the ones costing the most bandwidth first, then the biggest ones
+		Entries.Sort([](const FEntry& A, const FEntry& B)
+		{
+			if (A.ReplicatedBytes != B.ReplicatedBytes) return A.ReplicatedBytes > B.ReplicatedBytes;
+			return A.Report.GetTotalBytes() > B.Report.GetTotalBytes();
+		});
+
+		Ar.Logf(TEXT("Top %i of %i inventories (replicated bytes in the last %i seconds, memory bytes):"), FMath::Min(Count, Entries.Num()), Entries.Num(), Seconds);
+		for (int32 EntryIndex = 0; EntryIndex < FMath::Min(Count, Entries.Num()); EntryIndex++)
+		{
+			const FEntry& Entry = Entries[EntryIndex];
+			Ar.Logf(TEXT("  %8llu %10lld  %s.%s (%i/%i slots, %i items, %i delegate bindings)"),
+				Entry.ReplicatedBytes, Entry.Report.GetTotalBytes(), *GetNameSafe(Entry.Inventory->GetOwner()), *Entry.Inventory->GetName(),
+				Entry.Report.OccupiedSlotCount, Entry.Report.SlotCount, Entry.Report.ItemCount, Entry.Report.DelegateBindingCount);
+		}
+	}
+
+	static FAutoConsoleCommandWithWorldArgsAndOutputDevice DumpInventoryCommand(
+		TEXT("xiu.DumpInventory"),
+		TEXT("xiu.DumpInventory <actor>: slots, items, memory and replicated bytes of the inventories of matching actors"),
+		FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&DumpInventory));
+
+	static FAutoConsoleCommandWithWorldArgsAndOutputDevice StatsCommand(
+		TEXT("xiu.Stats"),
+		TEXT("xiu.Stats [Seconds]: totals of every inventory of the world (slots, items, delegate bindings, memory, replicated bytes)"),
+		FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&Stats));
+
+	static FAutoConsoleCommandWithWorldArgsAndOutputDevice TopContainersCommand(
+		TEXT("xiu.TopContainers"),
+		TEXT("xiu.TopContainers [Count] [Seconds]: inventories costing the most replicated bytes and memory"),
+		FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&TopContainers));
+}
@@ -0,0 +1,337 @@
+// Copyright XyloIsCoding 2024
+
+
+#include "Inventory/XIUInventoryJournal.h"
+
+#include "HAL/FileManager.h"
+#include "HAL/RunnableThread.h"
+#include "Inventory/XIUInventoryComponent.h"
+#include "Inventory/XIUInventoryUtilLibrary.h"
+#include "Inventory/Item/XIUItem.h"
+#include "Inventory/Item/XIUItemDefinition.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/MemoryReader.h"
+
+
+namespace XIUInventoryJournal
+{
+	static constexpr uint32 Magic = 0x4A554958; // "XIUJ"
+	static constexpr uint8 Version = 2;
+	/** Milliseconds the writer sleeps between flushes, unless woken up by a filling ring */
+	static constexpr uint32 FlushInterval = 100;
+
+	enum class EChunk : uint8
+	{
+		Definition,
+		Records,
+		/** Records were dropped here, because the writer could not keep up */
+		Dropped
+	};
+}
+
+FArchive& operator<<(FArchive& Ar, FXIUJournalRecord& Record)
+{
+	uint8 Op = static_cast<uint8>(Record.Op);
+	Ar << Op;
+	Ar << Record.Frame;
+	Ar << Record.Definition;
+	Ar << Record.Source;
+	Ar << Record.Slot;
+	Ar << Record.Delta;
+	Ar << Record.NewCount;
+	Record.Op = static_cast<EXIUJournalOp>(Op);
+	return Ar;
+}
+
+
+FXIUInventoryJournal::FXIUInventoryJournal(const FString& InPath, const uint32 Capacity)
+	: Path(InPath)
+{
+	const uint32 RingSize = FMath::RoundUpToPowerOfTwo(FMath::Max(Capacity, 2u));
+	Ring.SetNum(RingSize);
+	RingMask = RingSize - 1;
+	WakeUpEvent = FPlatformProcess::GetSynchEventFromPool(false);
+}
+
+FXIUInventoryJournal::~FXIUInventoryJournal()
+{
+	Shutdown();
+	FPlatformProcess::ReturnSynchEventToPool(WakeUpEvent);
+	WakeUpEvent = nullptr;
+}
+
+bool FXIUInventoryJournal::Start()
+{
+	check(!Thread);
+
+	Writer.Reset(IFileManager::Get().CreateFileWriter(*Path));
+	if (!Writer)
+	{
+		UE_LOG(LogTemp, Error, TEXT("FXIUInventoryJournal::Start -> Could not create [%s]"), *Path)
+		return false;
+	}
+	uint32 Magic = XIUInventoryJournal::Magic;
+	uint8 Version = XIUInventoryJournal::Version;
+	*Writer << Magic;
+	*Writer << Version;
+
+	bStopping = false;
+	Thread = FRunnableThread::Create(this, TEXT("XIUInventoryJournal"), 0, TPri_BelowNormal);
+	return Thread != nullptr;
+}
+
+void FXIUInventoryJournal::Shutdown()
+{
+	if (Thread)
+	{
+		Stop();
+		Thread->WaitForCompletion();
+		delete Thread;
+		Thread = nullptr;
+	}
+	Writer.Reset();
+
+	if (const uint64 Dropped = GetDroppedCount())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("FXIUInventoryJournal::Shutdown -> [%s] dropped %llu records (writer could not keep up)"), *Path, Dropped)
+	}
+}
+
+void FXIUInventoryJournal::Record(const EXIUJournalOp Op, const int32 Slot, const UXIUItemDefinition* ItemDefinition, const int32 Delta, const int32 NewCount)
+{
+	uint32 Definition = 0;
+	if (ItemDefinition)
+	{
+		if (const uint32* Id = DefinitionIds.Find(ItemDefinition))
+		{
+			Definition = *Id;
+		}
+		else
+		{
+			Definition = DefinitionIds.Num() + 1;
+			DefinitionIds.Add(ItemDefinition, Definition);
+			PendingDefinitions.Enqueue(TPair<uint32, FString>(Definition, ItemDefinition->GetPathName()));
+		}
+	}
+
+	const uint64 Write = WriteIndex.load(std::memory_order_relaxed);
+	if (Write - ReadIndex.load(std::memory_order_acquire) > RingMask)
+	{
+		DroppedCount.fetch_add(1, std::memory_order_relaxed);
+		WakeUpEvent->Trigger();
+		return;
+	}
+
+	FXIUJournalRecord& Record = Ring[Write & RingMask];
+	Record.Op = Op;
+	Record.Frame = GFrameCounter;
+	Record.Definition = Definition;
+	Record.Source = CurrentSource;
+	Record.Slot = Slot;
+	Record.Delta = Delta;
+	Record.NewCount = NewCount;
+	WriteIndex.store(Write + 1, std::memory_order_release);
+
+	// wake the writer up every half ring, so it never gets full under a steady load
+	if (((Write + 1) & (RingMask >> 1)) == 0) WakeUpEvent->Trigger();
+}
+
+uint32 FXIUInventoryJournal::GetSourceId(const UObject* Source)
+{
+	if (!Source) return 0;
+	
+	const TObjectKey<UObject> Key(Source);
+	if (const uint32* Id = SourceIds.Find(Key)) return *Id;
+	return SourceIds.Add(Key, GetTypeHash(Source->GetPathName()));
+}
+
+bool FXIUInventoryJournal::Replay(UXIUInventoryComponent* Inventory, TConstArrayView<uint8> Snapshot, TConstArrayView<uint8> Journal)
+{
+	if (!Inventory || !Inventory->GetOwner() || !Inventory->GetOwner()->HasAuthority()) return false;
+
+	// read everything first: a definition might be written after the first record using it
+	FMemoryReaderView Reader(Journal);
+	uint32 Magic = 0;
+	uint8 Version = 0;
+	Reader << Magic;
+	Reader << Version;
+	if (Reader.IsError() || Magic != XIUInventoryJournal::Magic || Version > XIUInventoryJournal::Version)
+	{
+		UE_LOG(LogTemp, Error, TEXT("FXIUInventoryJournal::Replay -> Invalid journal header"))
+		return false;
+	}
+
+	TMap<uint32, UXIUItemDefinition*> Definitions;
+	TArray<FXIUJournalRecord> Records;
+	uint64 DroppedRecords = 0;
+	while (!Reader.AtEnd() && !Reader.IsError())
+	{
+		uint8 Chunk = 0;
+		Reader << Chunk;
+		if (Chunk == static_cast<uint8>(XIUInventoryJournal::EChunk::Definition))
+		{
+			uint32 Id = 0;
+			FString DefinitionPath;
+			Reader << Id;
+			Reader << DefinitionPath;
+			Definitions.Add(Id, Cast<UXIUItemDefinition>(FSoftObjectPath(DefinitionPath).TryLoad()));
+		}
+		else if (Chunk == static_cast<uint8>(XIUInventoryJournal::EChunk::Records))
+		{
+			uint32 NumRecords = 0;
+			Reader << NumRecords;
+			for (uint32 RecordIndex = 0; RecordIndex < NumRecords; RecordIndex++)
+			{
+				FXIUJournalRecord Record;
+				Reader << Record;
+				if (Reader.IsError()) break;
+				Records.Add(Record);
+			}
+		}
+		else if (Chunk == static_cast<uint8>(XIUInventoryJournal::EChunk::Dropped))
+		{
+			uint64 Dropped = 0;
+			Reader << Dropped;
+			DroppedRecords += Dropped;
+		}
+		else
+		{
+			Reader.SetError();
+		}
+	}
+	if (Reader.IsError())
+	{
+		// the writer might have been killed in the middle of a chunk, so we still apply what was read
+		UE_LOG(LogTemp, Warning, TEXT("FXIUInventoryJournal::Replay -> Journal is truncated, replaying %i records"), Records.Num())
+	}
+
+	// with holes in the history the result would silently differ from the recorded inventory
+	if (DroppedRecords > 0)
+	{
+		UE_LOG(LogTemp, Error, TEXT("FXIUInventoryJournal::Replay -> Journal dropped %llu records, the inventory cannot be rebuilt"), DroppedRecords)
+		return false;
+	}
+
+	if (!Inventory->LoadSnapshot(Snapshot)) return false;
+
+	for (const FXIUJournalRecord& Record : Records)
+	{
+		if (Record.Slot < 0 || Record.Slot >= Inventory->GetInventorySize()) continue;
+
+		UXIUItemDefinition* const* Definition = Definitions.Find(Record.Definition);
+		UXIUItemDefinition* ItemDefinition = Definition ? *Definition : nullptr;
+		UXIUItem* CurrentItem = Inventory->GetItemAtSlot(Record.Slot);
+		if (CurrentItem && CurrentItem->GetItemDefinition() == ItemDefinition && Record.NewCount > 0)
+		{
+			CurrentItem->SetCount(Record.NewCount);
+		}
+		else if (!ItemDefinition || Record.NewCount <= 0)
+		{
+			if (CurrentItem) CurrentItem->SetCount(0);
+		}
+		else
+		{
+			UXIUItem* Item = UXIUInventoryUtilLibrary::MakeItemFromDefault(Inventory->GetOwner(), FXIUItemDefault(ItemDefinition, Record.NewCount));
+			Inventory->SetItemAtSlot(Record.Slot, Item);
+		}
+	}
+	return true;
+}
+
+bool FXIUInventoryJournal::ReplayFromFile(UXIUInventoryComponent* Inventory, const FString& JournalPath)
+{
+	TArray<uint8> Snapshot;
+	TArray<uint8> Journal;
+	if (!FFileHelper::LoadFileToArray(Snapshot, *(JournalPath + TEXT(".snapshot"))) || !FFileHelper::LoadFileToArray(Journal, *JournalPath))
+	{
+		UE_LOG(LogTemp, Error, TEXT("FXIUInventoryJournal::ReplayFromFile -> Could not read [%s] or its snapshot"), *JournalPath)
+		return false;
+	}
+	return Replay(Inventory, Snapshot, Journal);
+}
+
+FXIUInventoryJournal::FSourceScope::FSourceScope(FXIUInventoryJournal* InJournal, const UObject* Source)
+	: Journal(InJournal)
+	, PreviousSource(0)
+{
+	if (Journal)
+	{
+		PreviousSource = Journal->CurrentSource;
+		Journal->CurrentSource = Journal->GetSourceId(Source);
+	}
+}
+
+FXIUInventoryJournal::FSourceScope::~FSourceScope()
+{
+	if (Journal) Journal->CurrentSource = PreviousSource;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * FRunnable Interface
+ */
+
+uint32 FXIUInventoryJournal::Run()
+{
+	while (!bStopping.load(std::memory_order_acquire))
+	{
+		WakeUpEvent->Wait(XIUInventoryJournal::FlushInterval);
+		Flush();
+	}
+	// whatever got recorded before Stop
+	Flush();
+	return 0;
+}
+
+void FXIUInventoryJournal::Stop()
+{
+	bStopping.store(true, std::memory_order_release);
+	WakeUpEvent->Trigger();
+}
+
+void FXIUInventoryJournal::Flush()
+{
+	TPair<uint32, FString> Definition;
+	while (PendingDefinitions.Dequeue(Definition))
+	{
+		uint8 Chunk = static_cast<uint8>(XIUInventoryJournal::EChunk::Definition);
+		*Writer << Chunk;
+		*Writer << Definition.Key;
+		*Writer << Definition.Value;
+	}
+
+	uint64 Read = ReadIndex.load(std::memory_order_relaxed);
+	const uint64 Write = WriteIndex.load(std::memory_order_acquire);
+	if (Read != Write)
+	{
+		WriteBuffer.Reset();
+		for (; Read < Write; Read++)
+		{
+			WriteBuffer.Add(Ring[Read & RingMask]);
+		}
+		// slots can be reused as soon as they are copied
+		ReadIndex.store(Read, std::memory_order_release);
+
+		uint8 Chunk = static_cast<uint8>(XIUInventoryJournal::EChunk::Records);
+		uint32 NumRecords = WriteBuffer.Num();
+		*Writer << Chunk;
+		*Writer << NumRecords;
+		for (FXIUJournalRecord& Record : WriteBuffer)
+		{
+			*Writer << Record;
+		}
+	}
+
+	// records get dropped only while the ring is full, so right after what was in it is the closest we can tell
+	const uint64 Dropped = DroppedCount.load(std::memory_order_relaxed);
+	if (Dropped != WrittenDroppedCount)
+	{
+		uint8 Chunk = static_cast<uint8>(XIUInventoryJournal::EChunk::Dropped);
+		uint64 NewlyDropped = Dropped - WrittenDroppedCount;
+		*Writer << Chunk;
+		*Writer << NewlyDropped;
+		WrittenDroppedCount = Dropped;
+	}
+	Writer->Flush();
+}
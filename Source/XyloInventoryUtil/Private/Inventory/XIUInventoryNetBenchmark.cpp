@@ -0,0 +1,442 @@
+// Copyright XyloIsCoding 2024
+
+
+#include "Containers/Ticker.h"
+#include "Engine/Engine.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Inventory/XIUInventoryActor.h"
+#include "Inventory/XIUInventoryComponent.h"
+#include "Inventory/XIUPickUpInterface.h"
+#include "Inventory/Item/XIUContainerItem.h"
+#include "Inventory/Item/XIUDropFragment.h"
+#include "Inventory/Item/XIUItemActor.h"
+#include "Inventory/Item/XIUItemDefinition.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "UObject/UObjectIterator.h"
+
+
+/** Replication bandwidth benchmark. Runs scripted inventory scenarios on a server world that has clients connected
+ * in the same process (PIE with a listen or dedicated server and "Run Under One Process"), and reports the bytes
+ * and packets the server net driver sent for each of them. Can be automated with -ExecCmds="xiu.NetBench" */
+namespace XIUInventoryNetBenchmark
+{
+	/** Pickups spawned for the loot scenario */
+	static constexpr int32 LootCount = 50;
+	static constexpr int32 DefaultSlots = 32;
+	/** Seconds waited after each step, so every change (and its acks) went through before reading the stats */
+	static constexpr float DefaultSettleSeconds = 2.f;
+
+	struct FScenario
+	{
+		const TCHAR* Name;
+		/** Not measured */
+		TFunction<void()> Prepare;
+		/** Measured, together with everything it makes the server send until it settles */
+		TFunction<void()> Run;
+	};
+
+	struct FResult
+	{
+		FString Name;
+		uint64 Bytes = 0;
+		uint64 Packets = 0;
+		/** Part of Bytes written by the slot lists (see FXIUInventoryList::GetReplicatedBytes) */
+		uint64 SlotDeltaBytes = 0;
+		double Seconds = 0.0;
+	};
+
+	class FBenchmark
+	{
+	public:
+		FBenchmark(UWorld* InWorld, const int32 InSlots, const float InSettleSeconds, TArray<UXIUItemDefinition*>&& InDefinitions);
+
+		/** Ticker callback. @return false once done */
+		bool Tick(float DeltaTime);
+
+	private:
+		enum class EPhase : uint8
+		{
+			Prepare,
+			SettlePrepare,
+			Run,
+			SettleRun
+		};
+
+		void BuildScenarios();
+		void Finish(const bool bAborted);
+		void WriteResults() const;
+		void ReadStats(uint64& OutBytes, uint64& OutPackets) const;
+		uint64 GetSlotDeltaBytes(const int32 Seconds) const;
+
+		AXIUInventoryActor* SpawnInventory(const FVector& Location);
+		void SpawnPickup(UXIUItemDefinition* ItemDefinition, const int32 Count, const FVector& Location);
+		UXIUInventoryComponent* GetInventory(const AXIUInventoryActor* InventoryActor) const;
+		static void SortInventory(UXIUInventoryComponent* Inventory);
+
+	private:
+		TWeakObjectPtr<UWorld> World;
+		int32 Slots;
+		float SettleSeconds;
+		int32 NumClients = 0;
+		FRandomStream Stream;
+		TArray<UXIUItemDefinition*> Definitions;
+		TArray<FScenario> Scenarios;
+		TArray<FResult> Results;
+
+		int32 ScenarioIndex = 0;
+		EPhase Phase = EPhase::Prepare;
+		double PhaseEndTime = 0.0;
+		double RunStartTime = 0.0;
+		uint64 StartBytes = 0;
+		uint64 StartPackets = 0;
+
+		TWeakObjectPtr<AXIUInventoryActor> FullBag;
+		TWeakObjectPtr<AXIUInventoryActor> Looter;
+		TArray<TWeakObjectPtr<AActor>> SpawnedActors;
+	};
+
+	/** Only one benchmark at a time, since they would measure each other */
+	static TUniquePtr<FBenchmark> ActiveBenchmark;
+
+	FBenchmark::FBenchmark(UWorld* InWorld, const int32 InSlots, const float InSettleSeconds, TArray<UXIUItemDefinition*>&& InDefinitions)
+		: World(InWorld)
+		, Slots(InSlots)
+		, SettleSeconds(InSettleSeconds)
+		, Stream(1)
+		, Definitions(MoveTemp(InDefinitions))
+	{
+		NumClients = InWorld->GetNetDriver()->ClientConnections.Num();
+		BuildScenarios();
+	}
+
+	void FBenchmark::BuildScenarios()
+	{
+		// noise floor: pawns and everything else replicating in the level
+		Scenarios.Add({ TEXT("Idle"), [](){}, [](){} });
+
+		// every connection gets the whole bag in its first bunch, exactly like a client joining next to it
+		Scenarios.Add({ TEXT("JoinFullBag"), [](){}, [this]()
+		{
+			AXIUInventoryActor* InventoryActor = SpawnInventory(FVector(0.f, 0.f, 100.f));
+			UXIUInventoryComponent* Inventory = GetInventory(InventoryActor);
+			if (!Inventory) return;
+			FullBag = InventoryActor;
+			for (int32 SlotIndex = 0; SlotIndex < Inventory->GetInventorySize(); SlotIndex++)
+			{
+				UXIUItemDefinition* ItemDefinition = Definitions[Stream.RandHelper(Definitions.Num())];
+				Inventory->AddItemDefault(FXIUItemDefault(ItemDefinition, FMath::Max(ItemDefinition->MaxCount, 1)));
+			}
+		}});
+
+		Scenarios.Add({ TEXT("Loot50"), [this]()
+		{
+			Looter = SpawnInventory(FVector(0.f, 200.f, 100.f));
+			for (int32 PickupIndex = 0; PickupIndex < LootCount; PickupIndex++)
+			{
+				UXIUItemDefinition* ItemDefinition = Definitions[Stream.RandHelper(Definitions.Num())];
+				SpawnPickup(ItemDefinition, Stream.RandRange(1, FMath::Max(ItemDefinition->MaxCount, 1)), FVector(PickupIndex * 50.f, 400.f, 100.f));
+			}
+		}, [this]()
+		{
+			UXIUInventoryComponent* Inventory = GetInventory(Looter.Get());
+			if (!Inventory) return;
+			for (const TWeakObjectPtr<AActor>& SpawnedActor : SpawnedActors)
+			{
+				if (SpawnedActor.IsValid() && SpawnedActor->Implements<UXIUPickUpInterface>()) IXIUPickUpInterface::Execute_TryPickUp(SpawnedActor.Get(), Inventory);
+			}
+		}});
+
+		Scenarios.Add({ TEXT("Sort"), [](){}, [this]()
+		{
+			SortInventory(GetInventory(Looter.Get()));
+		}});
+
+		Scenarios.Add({ TEXT("DropAll"), [](){}, [this]()
+		{
+			UXIUInventoryComponent* Inventory = GetInventory(Looter.Get());
+			if (!Inventory) return;
+			for (int32 SlotIndex = 0; SlotIndex < Inventory->GetInventorySize(); SlotIndex++)
+			{
+				if (!Inventory->GetItemAtSlot(SlotIndex)) continue;
+				const FTransform DropTransform(FVector(SlotIndex * 50.f, -400.f, 100.f));
+				if (AActor* DroppedActor = Inventory->DropItemAtSlot(DropTransform, SlotIndex)) SpawnedActors.Add(DroppedActor);
+			}
+		}});
+	}
+
+	bool FBenchmark::Tick(float DeltaTime)
+	{
+		UWorld* CurrentWorld = World.Get();
+		if (!CurrentWorld || !CurrentWorld->GetNetDriver())
+		{
+			Finish(true);
+			return false;
+		}
+
+		const double Now = FPlatformTime::Seconds();
+		switch (Phase)
+		{
+		case EPhase::Prepare:
+			Scenarios[ScenarioIndex].Prepare();
+			Phase = EPhase::SettlePrepare;
+			PhaseEndTime = Now + SettleSeconds;
+			break;
+		case EPhase::SettlePrepare:
+			if (Now < PhaseEndTime) break;
+			// the stats are read right before and right after the measured phase, so nothing else gets in
+			ReadStats(StartBytes, StartPackets);
+			RunStartTime = Now;
+			Scenarios[ScenarioIndex].Run();
+			Phase = EPhase::SettleRun;
+			PhaseEndTime = Now + SettleSeconds;
+			break;
+		case EPhase::SettleRun:
+			{
+				if (Now < PhaseEndTime) break;
+				FResult& Result = Results.AddDefaulted_GetRef();
+				Result.Name = Scenarios[ScenarioIndex].Name;
+				uint64 EndBytes = 0;
+				uint64 EndPackets = 0;
+				ReadStats(EndBytes, EndPackets);
+				Result.Bytes = EndBytes - StartBytes;
+				Result.Packets = EndPackets - StartPackets;
+				Result.Seconds = Now - RunStartTime;
+				Result.SlotDeltaBytes = GetSlotDeltaBytes(FMath::CeilToInt32(Result.Seconds));
+				UE_LOG(LogTemp, Display, TEXT("XIUInventoryNetBenchmark -> %s: %llu bytes, %llu packets"), *Result.Name, Result.Bytes, Result.Packets)
+
+				if (++ScenarioIndex >= Scenarios.Num())
+				{
+					Finish(false);
+					return false;
+				}
+				Phase = EPhase::Prepare;
+				break;
+			}
+		default:
+			break;
+		}
+		return true;
+	}
+
+	void FBenchmark::Finish(const bool bAborted)
+	{
+		if (bAborted)
+		{
+			UE_LOG(LogTemp, Error, TEXT("XIUInventoryNetBenchmark -> The server world went away, benchmark aborted after %i scenarios"), Results.Num())
+		}
+		else
+		{
+			WriteResults();
+		}
+		for (const TWeakObjectPtr<AActor>& SpawnedActor : SpawnedActors)
+		{
+			if (SpawnedActor.IsValid()) SpawnedActor->Destroy();
+		}
+		SpawnedActors.Empty();
+	}
+
+	void FBenchmark::WriteResults() const
+	{
+		FString Csv = FString::Printf(TEXT("Scenario,Bytes,Packets,BytesPerClient,SlotDeltaBytes,Seconds\n"));
+		for (const FResult& Result : Results)
+		{
+			Csv += FString::Printf(TEXT("%s,%llu,%llu,%llu,%llu,%.2f\n"), *Result.Name, Result.Bytes, Result.Packets,
+				Result.Bytes / FMath::Max(NumClients, 1), Result.SlotDeltaBytes, Result.Seconds);
+		}
+		Csv += FString::Printf(TEXT("\nMetric,Value\nClients,%i\nSlots,%i\nDefinitions,%i\nSettleSeconds,%.2f\n"), NumClients, Slots, Definitions.Num(), SettleSeconds);
+
+		const FString Path = FPaths::ProjectSavedDir() / TEXT("XyloInventoryUtil") / TEXT("NetBench") / FString::Printf(TEXT("NetBench-%s.csv"), *FDateTime::Now().ToString());
+		UE_LOG(LogTemp, Display, TEXT("XIUInventoryNetBenchmark -> Results (%i clients):\n%s"), NumClients, *Csv)
+		if (FFileHelper::SaveStringToFile(Csv, *Path))
+		{
+			UE_LOG(LogTemp, Display, TEXT("XIUInventoryNetBenchmark -> Results written to [%s]"), *Path)
+		}
+		else
+		{
+			UE_LOG(LogTemp, Error, TEXT("XIUInventoryNetBenchmark -> Could not write [%s]"), *Path)
+		}
+	}
+
+	void FBenchmark::ReadStats(uint64& OutBytes, uint64& OutPackets) const
+	{
+		OutBytes = 0;
+		OutPackets = 0;
+		const UWorld* CurrentWorld = World.Get();
+		const UNetDriver* NetDriver = CurrentWorld ? CurrentWorld->GetNetDriver() : nullptr;
+		if (!NetDriver) return;
+
+		// only what goes to the clients, summed over their connections
+		for (const UNetConnection* Connection : NetDriver->ClientConnections)
+		{
+			if (!Connection) continue;
+			OutBytes += Connection->OutTotalBytes;
+			OutPackets += Connection->OutTotalPackets;
+		}
+	}
+
+	uint64 FBenchmark::GetSlotDeltaBytes(const int32 Seconds) const
+	{
+		const UWorld* CurrentWorld = World.Get();
+		uint64 Bytes = 0;
+		for (TObjectIterator<UXIUInventoryComponent> It; It; ++It)
+		{
+			if (It->GetWorld() == CurrentWorld && !It->IsTemplate())
+			{
+				Bytes += It->GetReplicatedBytes(FMath::Clamp(Seconds, 1, FXIUInventoryList::ReplicatedBytesWindow));
+			}
+		}
+		return Bytes;
+	}
+
+	AXIUInventoryActor* FBenchmark::SpawnInventory(const FVector& Location)
+	{
+		UWorld* CurrentWorld = World.Get();
+		AXIUInventoryActor* InventoryActor = CurrentWorld->SpawnActorDeferred<AXIUInventoryActor>(AXIUInventoryActor::StaticClass(), FTransform(Location));
+		if (!InventoryActor) return nullptr;
+		// the benchmark measures the inventory, not how far the clients are from it
+		InventoryActor->bAlwaysRelevant = true;
+		InventoryActor->FinishSpawning(FTransform(Location));
+		SpawnedActors.Add(InventoryActor);
+
+		if (UXIUInventoryComponent* Inventory = GetInventory(InventoryActor))
+		{
+			while (Inventory->GetInventorySize() < Slots)
+			{
+				Inventory->AddSlot(FXIUInventorySlotSettings());
+			}
+		}
+		return InventoryActor;
+	}
+
+	void FBenchmark::SpawnPickup(UXIUItemDefinition* ItemDefinition, const int32 Count, const FVector& Location)
+	{
+		UWorld* CurrentWorld = World.Get();
+		AXIUItemActor* Pickup = CurrentWorld->SpawnActorDeferred<AXIUItemActor>(AXIUItemActor::StaticClass(), FTransform(Location));
+		if (!Pickup) return;
+		Pickup->bAlwaysRelevant = true;
+		Pickup->FinishSpawning(FTransform(Location));
+		Pickup->SetItemWithDefault(FXIUItemDefault(ItemDefinition, Count));
+		SpawnedActors.Add(Pickup);
+	}
+
+	UXIUInventoryComponent* FBenchmark::GetInventory(const AXIUInventoryActor* InventoryActor) const
+	{
+		return InventoryActor ? InventoryActor->FindComponentByClass<UXIUInventoryComponent>() : nullptr;
+	}
+
+	void FBenchmark::SortInventory(UXIUInventoryComponent* Inventory)
+	{
+		if (!Inventory) return;
+
+		// the inventory has no sort of its own, so this is the usual gameplay one: items by name then count, packed
+		// at the start. Copies are sorted, since SetItemAtSlot replaces (and destroys) the items we read from
+		TArray<UXIUItem*> Items;
+		for (int32 SlotIndex = 0; SlotIndex < Inventory->GetInventorySize(); SlotIndex++)
+		{
+			if (UXIUItem* Item = Inventory->GetItemAtSlot(SlotIndex)) Items.Add(Item->Duplicate(GetTransientPackage()));
+		}
+		Items.StableSort([](const UXIUItem& A, const UXIUItem& B)
+		{
+			const FString NameA = GetNameSafe(A.GetItemDefinition());
+			const FString NameB = GetNameSafe(B.GetItemDefinition());
+			return NameA != NameB ? NameA < NameB : A.GetCount() > B.GetCount();
+		});
+
+		for (int32 SlotIndex = 0; SlotIndex < Inventory->GetInventorySize(); SlotIndex++)
+		{
+			UXIUItem* CurrentItem = Inventory->GetItemAtSlot(SlotIndex);
+			if (!Items.IsValidIndex(SlotIndex))
+			{
+				if (CurrentItem) CurrentItem->SetCount(0);
+				continue;
+			}
+			// slots already holding the right stack are left alone, like a real sort would
+			if (CurrentItem && CurrentItem->GetItemDefinition() == Items[SlotIndex]->GetItemDefinition() && CurrentItem->GetCount() == Items[SlotIndex]->GetCount()) continue;
+			Inventory->SetItemAtSlot(SlotIndex, Items[SlotIndex]);
+		}
+	}
+
+	/** @return the server world among the ones running in this process (the console might belong to a client) */
+	static UWorld* FindServerWorld(UWorld* World)
+	{
+		auto IsServerWorld = [](const UWorld* InWorld)
+		{
+			return InWorld && InWorld->GetNetDriver() && (InWorld->GetNetMode() == NM_ListenServer || InWorld->GetNetMode() == NM_DedicatedServer);
+		};
+		if (IsServerWorld(World)) return World;
+		if (!GEngine) return nullptr;
+		for (const FWorldContext& WorldContext : GEngine->GetWorldContexts())
+		{
+			if (IsServerWorld(WorldContext.World())) return WorldContext.World();
+		}
+		return nullptr;
+	}
+
+	static void GetDefinitions(const TArray<FString>& Paths, TArray<UXIUItemDefinition*>& OutDefinitions)
+	{
+		for (const FString& Path : Paths)
+		{
+			UXIUItemDefinition* ItemDefinition = LoadObject<UXIUItemDefinition>(nullptr, *Path);
+			if (ItemDefinition && ItemDefinition->ItemClass) OutDefinitions.Add(ItemDefinition);
+		}
+		if (!OutDefinitions.IsEmpty()) return;
+
+		// definitions must be assets, clients could not resolve transient ones
+		for (TObjectIterator<UXIUItemDefinition> It; It; ++It)
+		{
+			if (!It->IsAsset() || !It->ItemClass || It->ItemClass->IsChildOf(UXIUContainerItem::StaticClass())) continue;
+			OutDefinitions.Add(*It);
+		}
+		// droppable ones first, so DropAll has something to do
+		OutDefinitions.StableSort([](const UXIUItemDefinition& A, const UXIUItemDefinition& B)
+		{
+			return A.FindFragmentByClass<UXIUDropFragment>() && !B.FindFragmentByClass<UXIUDropFragment>();
+		});
+		if (OutDefinitions.Num() > 8) OutDefinitions.SetNum(8);
+	}
+
+	static void NetBench(const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+	{
+		if (ActiveBenchmark)
+		{
+			Ar.Log(TEXT("A benchmark is already running"));
+			return;
+		}
+
+		UWorld* ServerWorld = FindServerWorld(World);
+		if (!ServerWorld || ServerWorld->GetNetDriver()->ClientConnections.IsEmpty())
+		{
+			Ar.Log(TEXT("No server world with connected clients in this process. Play in editor with a listen or dedicated server, at least one client and Run Under One Process"));
+			return;
+		}
+
+		const int32 Slots = Args.IsValidIndex(0) && Args[0].IsNumeric() ? FMath::Max(FCString::Atoi(*Args[0]), 1) : DefaultSlots;
+		const float SettleSeconds = Args.IsValidIndex(1) && Args[1].IsNumeric() ? FMath::Max(FCString::Atof(*Args[1]), 0.1f) : DefaultSettleSeconds;
+		TArray<UXIUItemDefinition*> Definitions;
+		GetDefinitions(Args.Num() > 2 ? TArray<FString>(Args.GetData() + 2, Args.Num() - 2) : TArray<FString>(), Definitions);
+		if (Definitions.IsEmpty())
+		{
+			Ar.Log(TEXT("No item definition asset loaded, pass their paths after Slots and SettleSeconds"));
+			return;
+		}
+
+		Ar.Logf(TEXT("Running the inventory net benchmark on %s (%i clients, %i definitions), results in the log"),
+			*ServerWorld->GetName(), ServerWorld->GetNetDriver()->ClientConnections.Num(), Definitions.Num());
+		ActiveBenchmark = MakeUnique<FBenchmark>(ServerWorld, Slots, SettleSeconds, MoveTemp(Definitions));
+		FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([](float DeltaTime)
+		{
+			if (ActiveBenchmark && ActiveBenchmark->Tick(DeltaTime)) return true;
+			ActiveBenchmark.Reset();
+			return false;
+		}));
+	}
+
+	static FAutoConsoleCommandWithWorldArgsAndOutputDevice NetBenchCommand(
+		TEXT("xiu.NetBench"),
+		TEXT("xiu.NetBench [Slots] [SettleSeconds] [Definitions...]: bytes and packets the server sends to its in-process clients for scripted inventory scenarios (join with a full bag, loot 50 items, sort, drop all)"),
+		FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&NetBench));
+}
@@ -0,0 +1,146 @@
+// Copyright XyloIsCoding 2024
+
+
+#include "Inventory/XIUInventoryPageStore.h"
+
+#include "Async/Async.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+
+FXIUInventoryPageStore::FXIUInventoryPageStore()
+{
+	Directory = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("XyloInventoryUtil"), TEXT("PageStore"), FGuid::NewGuid().ToString());
+}
+
+FXIUInventoryPageStore::~FXIUInventoryPageStore()
+{
+	for (TPair<int32, TFuture<void>>& Operation : LastOperations)
+	{
+		if (Operation.Value.IsValid()) Operation.Value.Wait();
+	}
+	IFileManager::Get().DeleteDirectory(*Directory, false, true);
+}
+
+void FXIUInventoryPageStore::WritePage(const int32 PageIndex, TArray<uint8>&& Data)
+{
+	FPendingPageRef Page = MakeShared<FPendingPage, ESPMode::ThreadSafe>();
+	Page->Data = MoveTemp(Data);
+	Page->bWrite = true;
+	PendingPages.Add(PageIndex, Page);
+	
+	Launch(PageIndex, [Page, Path = GetPagePath(PageIndex)]()
+	{
+		Page->bSucceeded = FFileHelper::SaveArrayToFile(Page->Data, *Path);
+		Page->bDone = true;
+	});
+}
+
+void FXIUInventoryPageStore::PrefetchPage(const int32 PageIndex)
+{
+	if (PendingPages.Contains(PageIndex)) return;
+	
+	FPendingPageRef Page = MakeShared<FPendingPage, ESPMode::ThreadSafe>();
+	PendingPages.Add(PageIndex, Page);
+	
+	Launch(PageIndex, [Page, Path = GetPagePath(PageIndex)]()
+	{
+		Page->bSucceeded = FFileHelper::LoadFileToArray(Page->Data, *Path);
+		Page->bDone = true;
+	});
+}
+
+bool FXIUInventoryPageStore::IsPageInMemory(const int32 PageIndex) const
+{
+	const FPendingPageRef* Page = PendingPages.Find(PageIndex);
+	return Page && ((*Page)->bWrite || ((*Page)->bDone && (*Page)->bSucceeded));
+}
+
+bool FXIUInventoryPageStore::ReadPage(const int32 PageIndex, TArray<uint8>& OutData)
+{
+	if (const FPendingPageRef* PagePtr = PendingPages.Find(PageIndex))
+	{
+		const FPendingPageRef Page = *PagePtr;
+		
+		// the data being written does not change anymore, so it can be read while the write is running
+		if (Page->bWrite)
+		{
+			OutData = Page->Data;
+			return true;
+		}
+
+		WaitForPage(PageIndex);
+		PendingPages.Remove(PageIndex);
+		if (Page->bSucceeded)
+		{
+			OutData = MoveTemp(Page->Data);
+			return true;
+		}
+	}
+
+	WaitForPage(PageIndex);
+	return FFileHelper::LoadFileToArray(OutData, *GetPagePath(PageIndex));
+}
+
+void FXIUInventoryPageStore::RemovePage(const int32 PageIndex)
+{
+	PendingPages.Remove(PageIndex);
+	Launch(PageIndex, [Path = GetPagePath(PageIndex)]()
+	{
+		IFileManager::Get().Delete(*Path, false, false, true);
+	});
+}
+
+void FXIUInventoryPageStore::ReleaseWrittenPages()
+{
+	for (auto It = PendingPages.CreateIterator(); It; ++It)
+	{
+		FPendingPage& Page = It.Value().Get();
+		if (!Page.bWrite || !Page.bDone) continue;
+		
+		if (Page.bSucceeded)
+		{
+			It.RemoveCurrent();
+		}
+		else if (!Page.bFailureReported)
+		{
+			// the page stays in memory, so nothing is lost
+			UE_LOG(LogTemp, Error, TEXT("FXIUInventoryPageStore::ReleaseWrittenPages -> Could not write [%s]"), *GetPagePath(It.Key()))
+			Page.bFailureReported = true;
+		}
+	}
+	
+	for (auto It = LastOperations.CreateIterator(); It; ++It)
+	{
+		if (It.Value().IsReady()) It.RemoveCurrent();
+	}
+}
+
+void FXIUInventoryPageStore::Launch(const int32 PageIndex, TUniqueFunction<void()>&& Operation)
+{
+	TFuture<void> Previous;
+	if (TFuture<void>* LastOperation = LastOperations.Find(PageIndex))
+	{
+		Previous = MoveTemp(*LastOperation);
+	}
+	
+	LastOperations.Add(PageIndex, Async(EAsyncExecution::ThreadPool, [Previous = MoveTemp(Previous), Operation = MoveTemp(Operation)]() mutable
+	{
+		if (Previous.IsValid()) Previous.Wait();
+		Operation();
+	}));
+}
+
+void FXIUInventoryPageStore::WaitForPage(const int32 PageIndex)
+{
+	if (TFuture<void>* LastOperation = LastOperations.Find(PageIndex))
+	{
+		if (LastOperation->IsValid()) LastOperation->Wait();
+	}
+}
+
+FString FXIUInventoryPageStore::GetPagePath(const int32 PageIndex) const
+{
+	return FPaths::Combine(Directory, FString::Printf(TEXT("Page_%i.xiupage"), PageIndex));
+}
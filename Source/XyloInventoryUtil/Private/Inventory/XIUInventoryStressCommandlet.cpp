@@ -0,0 +1,514 @@
+// Copyright XyloIsCoding 2024
+
+
+#include "Inventory/XIUInventoryStressCommandlet.h"
+
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "Inventory/XIUInventoryActor.h"
+#include "Inventory/XIUInventoryComponent.h"
+#include "Inventory/XIUPickUpInterface.h"
+#include "Inventory/Item/XIUContainerItem.h"
+#include "Inventory/Item/XIUDropFragment.h"
+#include "Inventory/Item/XIUItemActor.h"
+#include "Inventory/Item/XIUItemDefinition.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "UObject/UObjectIterator.h"
+
+
+namespace XIUInventoryStress
+{
+	enum class EOp : uint8
+	{
+		Add,
+		Consume,
+		Transfer,
+		Drop,
+		PickUp,
+		Num
+	};
+
+	static const TCHAR* OpNames[] = { TEXT("Add"), TEXT("Consume"), TEXT("Transfer"), TEXT("Drop"), TEXT("PickUp") };
+	/** Relative frequency of each op */
+	static constexpr int32 OpWeights[] = { 30, 20, 20, 15, 15 };
+	/** Ops run between two checks of the clock */
+	static constexpr int32 OpsPerBatch = 256;
+	/** Violations logged one by one, the others are only counted */
+	static constexpr int32 MaxLoggedViolations = 20;
+
+	struct FSettings
+	{
+		int32 Seed = 1;
+		int32 Inventories = 100;
+		int32 Slots = 32;
+		int32 Pickups = 200;
+		int32 NumDefinitions = 8;
+		float Duration = 30.f;
+		float CheckInterval = 1.f;
+		float GCInterval = 5.f;
+		FString Definitions;
+		FString ItemClass;
+		FString Csv;
+	};
+
+	struct FRun
+	{
+		explicit FRun(const FSettings& InSettings)
+			: Settings(InSettings)
+			, Stream(InSettings.Seed)
+		{
+		}
+
+		bool Setup();
+		void TearDown();
+		void RunOp();
+		void CheckInvariants();
+		void CollectGarbageTimed();
+		void SampleObjectCount();
+		bool WriteCsv(const double Elapsed) const;
+
+	private:
+		bool SetupDefinitions();
+		UXIUInventoryComponent* GetRandomInventory() { return Inventories[Stream.RandHelper(Inventories.Num())]; }
+		UXIUItemDefinition* GetRandomDefinition() { return Definitions[Stream.RandHelper(Definitions.Num())]; }
+		/** @return a slot holding an item, or INDEX_NONE if a few tries found none */
+		int32 GetRandomOccupiedSlot(UXIUInventoryComponent* Inventory);
+		AActor* SpawnPickup(UXIUItemDefinition* ItemDefinition, const int32 Count);
+		FTransform GetRandomTransform() { return FTransform(FVector(Stream.FRandRange(-5000.f, 5000.f), Stream.FRandRange(-5000.f, 5000.f), 0.f)); }
+		void ReportViolation(const FString& Violation);
+
+	public:
+		FSettings Settings;
+		FRandomStream Stream;
+		UWorld* World = nullptr;
+		TArray<UXIUItemDefinition*> Definitions;
+		TArray<UXIUInventoryComponent*> Inventories;
+		TArray<TWeakObjectPtr<AActor>> Pickups;
+		/** What the inventories and pickups should hold, by definition */
+		TMap<const UXIUItemDefinition*, int64> ExpectedCounts;
+
+		/** Microseconds of each op, by op */
+		TArray<float> Latencies[static_cast<int32>(EOp::Num)];
+		int64 TotalOps = 0;
+		int32 Violations = 0;
+		int32 PeakObjectCount = 0;
+		int32 GCCount = 0;
+		double GCTotalSeconds = 0.0;
+		double GCMaxSeconds = 0.0;
+	};
+
+	static float GetPercentile(TArray<float>& SortedValues, const float Percentile)
+	{
+		if (SortedValues.IsEmpty()) return 0.f;
+		return SortedValues[FMath::Min(FMath::FloorToInt32(Percentile * SortedValues.Num()), SortedValues.Num() - 1)];
+	}
+
+	bool FRun::Setup()
+	{
+		if (!SetupDefinitions()) return false;
+
+		World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("XIUInventoryStress"));
+		World->AddToRoot();
+		FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+		WorldContext.SetCurrentWorld(World);
+		World->InitializeActorsForPlay(FURL());
+		World->BeginPlay();
+
+		for (int32 InventoryIndex = 0; InventoryIndex < Settings.Inventories; InventoryIndex++)
+		{
+			const AXIUInventoryActor* InventoryActor = World->SpawnActor<AXIUInventoryActor>(AXIUInventoryActor::StaticClass(), GetRandomTransform());
+			UXIUInventoryComponent* Inventory = InventoryActor ? InventoryActor->FindComponentByClass<UXIUInventoryComponent>() : nullptr;
+			if (!Inventory) continue;
+
+			// the inventory got initialized with its default size during BeginPlay
+			while (Inventory->GetInventorySize() < Settings.Slots)
+			{
+				Inventory->AddSlot(FXIUInventorySlotSettings());
+			}
+			Inventories.Add(Inventory);
+		}
+		if (Inventories.IsEmpty())
+		{
+			UE_LOG(LogTemp, Error, TEXT("UXIUInventoryStressCommandlet::Main -> Could not spawn any inventory"))
+			return false;
+		}
+
+		for (int32 PickupIndex = 0; PickupIndex < Settings.Pickups; PickupIndex++)
+		{
+			UXIUItemDefinition* ItemDefinition = GetRandomDefinition();
+			SpawnPickup(ItemDefinition, Stream.RandRange(1, FMath::Max(ItemDefinition->MaxCount, 1)));
+		}
+		return true;
+	}
+
+	bool FRun::SetupDefinitions()
+	{
+		if (!Settings.Definitions.IsEmpty())
+		{
+			TArray<FString> Paths;
+			Settings.Definitions.ParseIntoArray(Paths, TEXT(","));
+			for (const FString& Path : Paths)
+			{
+				UXIUItemDefinition* ItemDefinition = LoadObject<UXIUItemDefinition>(nullptr, *Path);
+				if (!ItemDefinition || !ItemDefinition->ItemClass)
+				{
+					UE_LOG(LogTemp, Error, TEXT("UXIUInventoryStressCommandlet::Main -> [%s] is not a valid item definition"), *Path)
+					continue;
+				}
+				ItemDefinition->AddToRoot();
+				Definitions.Add(ItemDefinition);
+			}
+			return !Definitions.IsEmpty();
+		}
+
+		UClass* ItemClass = nullptr;
+		if (!Settings.ItemClass.IsEmpty())
+		{
+			ItemClass = LoadClass<UXIUItem>(nullptr, *Settings.ItemClass);
+		}
+		else
+		{
+			for (TObjectIterator<UClass> It; It; ++It)
+			{
+				if (!It->IsChildOf(UXIUItem::StaticClass()) || It->IsChildOf(UXIUContainerItem::StaticClass())) continue;
+				if (It->HasAnyClassFlags(CLASS_Abstract | CLASS_Deprecated | CLASS_NewerVersionExists)) continue;
+				if (It->GetName().StartsWith(TEXT("SKEL_")) || It->GetName().StartsWith(TEXT("REINST_"))) continue;
+				ItemClass = *It;
+				break;
+			}
+		}
+		if (!ItemClass || ItemClass->HasAnyClassFlags(CLASS_Abstract))
+		{
+			UE_LOG(LogTemp, Error, TEXT("UXIUInventoryStressCommandlet::Main -> No concrete item class found, use -ItemClass= or -Definitions="))
+			return false;
+		}
+
+		for (int32 DefinitionIndex = 0; DefinitionIndex < FMath::Max(Settings.NumDefinitions, 1); DefinitionIndex++)
+		{
+			UXIUItemDefinition* ItemDefinition = NewObject<UXIUItemDefinition>(GetTransientPackage(), *FString::Printf(TEXT("XIUStressDefinition_%i"), DefinitionIndex));
+			ItemDefinition->ItemClass = ItemClass;
+			ItemDefinition->ItemName = ItemDefinition->GetName();
+			// some items do not stack at all
+			ItemDefinition->MaxCount = DefinitionIndex % 4 == 0 ? 1 : Stream.RandRange(2, 99);
+			UXIUDropFragment* DropFragment = NewObject<UXIUDropFragment>(ItemDefinition);
+			DropFragment->ItemDropActor = AXIUItemActor::StaticClass();
+			ItemDefinition->Fragments.Add(DropFragment);
+			ItemDefinition->AddToRoot();
+			Definitions.Add(ItemDefinition);
+		}
+		return true;
+	}
+
+	void FRun::TearDown()
+	{
+		if (World)
+		{
+			GEngine->DestroyWorldContext(World);
+			World->DestroyWorld(false);
+			World->RemoveFromRoot();
+			World = nullptr;
+		}
+		for (UXIUItemDefinition* ItemDefinition : Definitions)
+		{
+			ItemDefinition->RemoveFromRoot();
+		}
+		Definitions.Empty();
+		Inventories.Empty();
+		Pickups.Empty();
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+	}
+
+	void FRun::RunOp()
+	{
+		int32 Roll = Stream.RandHelper(30 + 20 + 20 + 15 + 15); // sum of OpWeights
+		EOp Op = EOp::Add;
+		for (int32 OpIndex = 0; OpIndex < static_cast<int32>(EOp::Num); OpIndex++)
+		{
+			if (Roll < OpWeights[OpIndex])
+			{
+				Op = static_cast<EOp>(OpIndex);
+				break;
+			}
+			Roll -= OpWeights[OpIndex];
+		}
+
+		// every random choice is made before the clock starts, so only the inventory work is measured
+		UXIUInventoryComponent* Inventory = GetRandomInventory();
+		UXIUItemDefinition* ItemDefinition = GetRandomDefinition();
+		const int32 Count = Stream.RandRange(1, FMath::Max(ItemDefinition->MaxCount, 1));
+		uint64 StartCycles = 0;
+		switch (Op)
+		{
+		case EOp::Add:
+			{
+				// up to three stacks at once, to go through the placement planner
+				const FXIUItemDefault ItemDefault(ItemDefinition, Count * Stream.RandRange(1, 3));
+				StartCycles = FPlatformTime::Cycles64();
+				const int32 Leftover = Inventory->AddItemDefaults(MakeArrayView(&ItemDefault, 1));
+				ExpectedCounts.FindOrAdd(ItemDefinition) += ItemDefault.Count - Leftover;
+				break;
+			}
+		case EOp::Consume:
+			{
+				StartCycles = FPlatformTime::Cycles64();
+				const int32 Consumed = Inventory->ConsumeItemsByDefinition(ItemDefinition, Count);
+				ExpectedCounts.FindOrAdd(ItemDefinition) -= Consumed;
+				break;
+			}
+		case EOp::Transfer:
+			{
+				UXIUInventoryComponent* OtherInventory = GetRandomInventory();
+				const int32 SlotIndex = GetRandomOccupiedSlot(Inventory);
+				if (SlotIndex == INDEX_NONE || OtherInventory == Inventory) return;
+				StartCycles = FPlatformTime::Cycles64();
+				Inventory->TransferItemFromSlot(SlotIndex, OtherInventory);
+				break;
+			}
+		case EOp::Drop:
+			{
+				const int32 SlotIndex = GetRandomOccupiedSlot(Inventory);
+				if (SlotIndex == INDEX_NONE) return;
+				const FTransform DropTransform = GetRandomTransform();
+				// half of the drops are whole stacks
+				const int32 DropCount = Stream.RandBool() ? -1 : Count;
+				StartCycles = FPlatformTime::Cycles64();
+				if (AActor* DroppedActor = Inventory->DropItemAtSlot(DropTransform, SlotIndex, DropCount)) Pickups.Add(DroppedActor);
+				break;
+			}
+		case EOp::PickUp:
+			{
+				Pickups.RemoveAllSwap([](const TWeakObjectPtr<AActor>& Pickup) { return !Pickup.IsValid() || Pickup->IsActorBeingDestroyed(); });
+				if (Pickups.IsEmpty()) return;
+				AActor* Pickup = Pickups[Stream.RandHelper(Pickups.Num())].Get();
+				StartCycles = FPlatformTime::Cycles64();
+				IXIUPickUpInterface::Execute_TryPickUp(Pickup, Inventory);
+				break;
+			}
+		default:
+			return;
+		}
+
+		const float Microseconds = static_cast<float>(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles) * 1000.0);
+		Latencies[static_cast<int32>(Op)].Add(Microseconds);
+		TotalOps++;
+	}
+
+	int32 FRun::GetRandomOccupiedSlot(UXIUInventoryComponent* Inventory)
+	{
+		if (Inventory->IsInventoryEmpty()) return INDEX_NONE;
+		for (int32 Try = 0; Try < 8; Try++)
+		{
+			const int32 SlotIndex = Stream.RandHelper(Inventory->GetInventorySize());
+			if (Inventory->GetItemAtSlot(SlotIndex)) return SlotIndex;
+		}
+		return INDEX_NONE;
+	}
+
+	AActor* FRun::SpawnPickup(UXIUItemDefinition* ItemDefinition, const int32 Count)
+	{
+		AXIUItemActor* Pickup = World->SpawnActor<AXIUItemActor>(AXIUItemActor::StaticClass(), GetRandomTransform());
+		if (!Pickup) return nullptr;
+
+		Pickup->SetItemWithDefault(FXIUItemDefault(ItemDefinition, Count));
+		ExpectedCounts.FindOrAdd(ItemDefinition) += Count;
+		Pickups.Add(Pickup);
+		return Pickup;
+	}
+
+	void FRun::CheckInvariants()
+	{
+		TSet<const UXIUItem*> SeenItems;
+		TMap<const UXIUItemDefinition*, int64> ActualCounts;
+		auto CheckItem = [this, &SeenItems, &ActualCounts](const UXIUItem* Item, const FString& Where)
+		{
+			bool bAlreadySeen = false;
+			SeenItems.Add(Item, &bAlreadySeen);
+			if (bAlreadySeen) ReportViolation(FString::Printf(TEXT("%s holds %s, which is also somewhere else"), *Where, *GetNameSafe(Item)));
+			if (Item->GetCount() < 0 || Item->GetCount() > FMath::Max(Item->GetMaxCount(), 1))
+			{
+				ReportViolation(FString::Printf(TEXT("%s holds %s with count %i (max %i)"), *Where, *GetNameSafe(Item), Item->GetCount(), Item->GetMaxCount()));
+			}
+			ActualCounts.FindOrAdd(Item->GetItemDefinition()) += Item->GetCount();
+		};
+
+		for (UXIUInventoryComponent* Inventory : Inventories)
+		{
+			int32 OccupiedSlots = 0;
+			int64 TotalCount = 0;
+			for (int32 SlotIndex = 0; SlotIndex < Inventory->GetInventorySize(); SlotIndex++)
+			{
+				const UXIUItem* Item = Inventory->GetItemAtSlot(SlotIndex);
+				if (!Item) continue;
+				OccupiedSlots++;
+				TotalCount += Item->GetCount();
+				CheckItem(Item, FString::Printf(TEXT("%s slot %i"), *GetNameSafe(Inventory->GetOwner()), SlotIndex));
+			}
+			if (OccupiedSlots != Inventory->GetOccupiedSlotCount() || TotalCount != Inventory->GetTotalItemCount())
+			{
+				ReportViolation(FString::Printf(TEXT("%s tracks %i slots and %i items, but holds %i slots and %lld items"),
+					*GetNameSafe(Inventory->GetOwner()), Inventory->GetOccupiedSlotCount(), Inventory->GetTotalItemCount(), OccupiedSlots, TotalCount));
+			}
+		}
+		for (const TWeakObjectPtr<AActor>& Pickup : Pickups)
+		{
+			if (!Pickup.IsValid() || Pickup->IsActorBeingDestroyed()) continue;
+			if (const UXIUItem* Item = IXIUPickUpInterface::Execute_GetItem(Pickup.Get())) CheckItem(Item, Pickup->GetName());
+		}
+
+		for (const UXIUItemDefinition* ItemDefinition : Definitions)
+		{
+			const int64* Expected = ExpectedCounts.Find(ItemDefinition);
+			const int64* Actual = ActualCounts.Find(ItemDefinition);
+			if ((Expected ? *Expected : 0) != (Actual ? *Actual : 0))
+			{
+				ReportViolation(FString::Printf(TEXT("%s count is %lld, expected %lld"), *ItemDefinition->GetName(), Actual ? *Actual : 0, Expected ? *Expected : 0));
+			}
+		}
+		// only report each drift once
+		for (const TPair<const UXIUItemDefinition*, int64>& Actual : ActualCounts)
+		{
+			ExpectedCounts.Add(Actual.Key, Actual.Value);
+		}
+		for (TPair<const UXIUItemDefinition*, int64>& Expected : ExpectedCounts)
+		{
+			if (!ActualCounts.Contains(Expected.Key)) Expected.Value = 0;
+		}
+	}
+
+	void FRun::ReportViolation(const FString& Violation)
+	{
+		if (Violations++ < MaxLoggedViolations)
+		{
+			UE_LOG(LogTemp, Error, TEXT("UXIUInventoryStressCommandlet::CheckInvariants -> %s"), *Violation)
+		}
+	}
+
+	void FRun::CollectGarbageTimed()
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+		const double GCSeconds = FPlatformTime::Seconds() - StartTime;
+		GCCount++;
+		GCTotalSeconds += GCSeconds;
+		GCMaxSeconds = FMath::Max(GCMaxSeconds, GCSeconds);
+	}
+
+	void FRun::SampleObjectCount()
+	{
+		PeakObjectCount = FMath::Max(PeakObjectCount, GUObjectArray.GetObjectArrayNumMinusAvailable());
+	}
+
+	bool FRun::WriteCsv(const double Elapsed) const
+	{
+		FString Csv = TEXT("Op,Count,OpsPerSec,P50Us,P99Us,MaxUs\n");
+		TArray<float> AllLatencies;
+		for (int32 OpIndex = 0; OpIndex < static_cast<int32>(EOp::Num); OpIndex++)
+		{
+			TArray<float> Sorted = Latencies[OpIndex];
+			Sorted.Sort();
+			AllLatencies.Append(Sorted);
+			Csv += FString::Printf(TEXT("%s,%i,%.1f,%.2f,%.2f,%.2f\n"), OpNames[OpIndex], Sorted.Num(), Sorted.Num() / Elapsed,
+				GetPercentile(Sorted, 0.5f), GetPercentile(Sorted, 0.99f), Sorted.IsEmpty() ? 0.f : Sorted.Last());
+		}
+		AllLatencies.Sort();
+		Csv += FString::Printf(TEXT("All,%lld,%.1f,%.2f,%.2f,%.2f\n"), TotalOps, TotalOps / Elapsed,
+			GetPercentile(AllLatencies, 0.5f), GetPercentile(AllLatencies, 0.99f), AllLatencies.IsEmpty() ? 0.f : AllLatencies.Last());
+
+		Csv += TEXT("\nMetric,Value\n");
+		Csv += FString::Printf(TEXT("Seed,%i\n"), Settings.Seed);
+		Csv += FString::Printf(TEXT("Inventories,%i\n"), Inventories.Num());
+		Csv += FString::Printf(TEXT("Slots,%i\n"), Settings.Slots);
+		Csv += FString::Printf(TEXT("DurationSeconds,%.2f\n"), Elapsed);
+		Csv += FString::Printf(TEXT("PeakUObjects,%i\n"), PeakObjectCount);
+		Csv += FString::Printf(TEXT("GCCount,%i\n"), GCCount);
+		Csv += FString::Printf(TEXT("GCTotalMs,%.2f\n"), GCTotalSeconds * 1000.0);
+		Csv += FString::Printf(TEXT("GCMaxMs,%.2f\n"), GCMaxSeconds * 1000.0);
+		Csv += FString::Printf(TEXT("InvariantViolations,%i\n"), Violations);
+
+		UE_LOG(LogTemp, Display, TEXT("UXIUInventoryStressCommandlet::Main -> Results:\n%s"), *Csv)
+		if (!FFileHelper::SaveStringToFile(Csv, *Settings.Csv))
+		{
+			UE_LOG(LogTemp, Error, TEXT("UXIUInventoryStressCommandlet::Main -> Could not write [%s]"), *Settings.Csv)
+			return false;
+		}
+		UE_LOG(LogTemp, Display, TEXT("UXIUInventoryStressCommandlet::Main -> Results written to [%s]"), *Settings.Csv)
+		return true;
+	}
+}
+
+
+UXIUInventoryStressCommandlet::UXIUInventoryStressCommandlet()
+{
+	IsClient = false;
+	IsServer = true;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UXIUInventoryStressCommandlet::Main(const FString& Params)
+{
+	XIUInventoryStress::FSettings Settings;
+	FParse::Value(*Params, TEXT("Seed="), Settings.Seed);
+	FParse::Value(*Params, TEXT("Inventories="), Settings.Inventories);
+	FParse::Value(*Params, TEXT("Slots="), Settings.Slots);
+	FParse::Value(*Params, TEXT("Pickups="), Settings.Pickups);
+	FParse::Value(*Params, TEXT("NumDefinitions="), Settings.NumDefinitions);
+	FParse::Value(*Params, TEXT("Duration="), Settings.Duration);
+	FParse::Value(*Params, TEXT("CheckInterval="), Settings.CheckInterval);
+	FParse::Value(*Params, TEXT("GCInterval="), Settings.GCInterval);
+	FParse::Value(*Params, TEXT("Definitions="), Settings.Definitions);
+	FParse::Value(*Params, TEXT("ItemClass="), Settings.ItemClass);
+	if (!FParse::Value(*Params, TEXT("Csv="), Settings.Csv))
+	{
+		Settings.Csv = FPaths::ProjectSavedDir() / TEXT("XyloInventoryUtil") / TEXT("Stress") / FString::Printf(TEXT("Stress-%s.csv"), *FDateTime::Now().ToString());
+	}
+	Settings.Inventories = FMath::Max(Settings.Inventories, 1);
+	Settings.Slots = FMath::Max(Settings.Slots, 1);
+
+	XIUInventoryStress::FRun Run(Settings);
+	if (!Run.Setup())
+	{
+		Run.TearDown();
+		return 1;
+	}
+	UE_LOG(LogTemp, Display, TEXT("UXIUInventoryStressCommandlet::Main -> Running %.0f seconds on %i inventories (seed %i)"), Settings.Duration, Run.Inventories.Num(), Settings.Seed)
+
+	const double StartTime = FPlatformTime::Seconds();
+	const double EndTime = StartTime + Settings.Duration;
+	double NextCheckTime = StartTime + Settings.CheckInterval;
+	double NextGCTime = StartTime + Settings.GCInterval;
+	double LastTickTime = StartTime;
+	double Now = StartTime;
+	while (Now < EndTime)
+	{
+		for (int32 OpIndex = 0; OpIndex < XIUInventoryStress::OpsPerBatch; OpIndex++)
+		{
+			Run.RunOp();
+		}
+		Run.SampleObjectCount();
+
+		Now = FPlatformTime::Seconds();
+		if (Now >= NextCheckTime)
+		{
+			// lets timers and pending destroys go through, as they would in game
+			Run.World->Tick(LEVELTICK_All, static_cast<float>(Now - LastTickTime));
+			LastTickTime = Now;
+			Run.CheckInvariants();
+			NextCheckTime = Now + Settings.CheckInterval;
+		}
+		if (Settings.GCInterval > 0.f && Now >= NextGCTime)
+		{
+			Run.CollectGarbageTimed();
+			NextGCTime = FPlatformTime::Seconds() + Settings.GCInterval;
+		}
+		Now = FPlatformTime::Seconds();
+	}
+	const double Elapsed = FMath::Max(Now - StartTime, UE_DOUBLE_SMALL_NUMBER);
+
+	Run.CheckInvariants();
+	const bool bWritten = Run.WriteCsv(Elapsed);
+	const int32 Violations = Run.Violations;
+	Run.TearDown();
+	return Violations == 0 && bWritten ? 0 : 1;
+}
@@ -0,0 +1,85 @@
+// Copyright XyloIsCoding 2024
+
+
+#include "Inventory/XIUInventoryTrace.h"
+
+#include "Inventory/Item/XIUItemDefinition.h"
+
+#if XIU_INVENTORY_TRACE_ENABLED
+
+UE_TRACE_CHANNEL_DEFINE(XIUInventoryChannel)
+
+UE_TRACE_EVENT_BEGIN(XIUInventory, ObjectName, NoSync|Important)
+	UE_TRACE_EVENT_FIELD(uint64, Id)
+	UE_TRACE_EVENT_FIELD(UE::Trace::WideString, Name)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(XIUInventory, SlotChange)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint64, Inventory)
+	UE_TRACE_EVENT_FIELD(uint64, Definition)
+	UE_TRACE_EVENT_FIELD(int32, Slot)
+	UE_TRACE_EVENT_FIELD(int32, Delta)
+	UE_TRACE_EVENT_FIELD(int32, NewCount)
+	UE_TRACE_EVENT_FIELD(uint8, Op)
+	UE_TRACE_EVENT_FIELD(bool, ItemChanged)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(XIUInventory, Replication)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint64, Inventory)
+	UE_TRACE_EVENT_FIELD(int32, NumSlots)
+	UE_TRACE_EVENT_FIELD(uint32, Bytes)
+	UE_TRACE_EVENT_FIELD(uint8, Kind)
+UE_TRACE_EVENT_END()
+
+
+EXIUInventoryTraceOp FXIUInventoryTrace::CurrentOp = EXIUInventoryTraceOp::None;
+
+void FXIUInventoryTrace::OutputSlotChange(const UObject* Inventory, const int32 Slot, const UXIUItemDefinition* ItemDefinition, const int32 Delta, const int32 NewCount, const bool bItemChanged)
+{
+	const uint64 InventoryId = GetObjectId(Inventory);
+	const uint64 DefinitionId = GetObjectId(ItemDefinition);
+	UE_TRACE_LOG(XIUInventory, SlotChange, XIUInventoryChannel)
+		<< SlotChange.Cycle(FPlatformTime::Cycles64())
+		<< SlotChange.Inventory(InventoryId)
+		<< SlotChange.Definition(DefinitionId)
+		<< SlotChange.Slot(Slot)
+		<< SlotChange.Delta(Delta)
+		<< SlotChange.NewCount(NewCount)
+		<< SlotChange.Op(static_cast<uint8>(CurrentOp))
+		<< SlotChange.ItemChanged(bItemChanged);
+}
+
+void FXIUInventoryTrace::OutputReplication(const UObject* Inventory, const EXIUInventoryTraceReplication Kind, const int32 NumSlots, const uint32 Bytes)
+{
+	const uint64 InventoryId = GetObjectId(Inventory);
+	UE_TRACE_LOG(XIUInventory, Replication, XIUInventoryChannel)
+		<< Replication.Cycle(FPlatformTime::Cycles64())
+		<< Replication.Inventory(InventoryId)
+		<< Replication.NumSlots(NumSlots)
+		<< Replication.Bytes(Bytes)
+		<< Replication.Kind(static_cast<uint8>(Kind));
+}
+
+uint64 FXIUInventoryTrace::GetObjectId(const UObject* Object)
+{
+	if (!Object) return 0;
+
+	// an address can be reused by a new object, so the set is reset once in a while to name objects again
+	static TSet<const UObject*> NamedObjects;
+	const uint64 Id = reinterpret_cast<UPTRINT>(Object);
+	bool bAlreadyNamed = false;
+	NamedObjects.Add(Object, &bAlreadyNamed);
+	if (!bAlreadyNamed)
+	{
+		if (NamedObjects.Num() > 4096) NamedObjects.Reset();
+		const FString Name = Object->GetPathName();
+		UE_TRACE_LOG(XIUInventory, ObjectName, XIUInventoryChannel)
+			<< ObjectName.Id(Id)
+			<< ObjectName.Name(*Name, Name.Len());
+	}
+	return Id;
+}
+
+#endif
@@ -0,0 +1,268 @@
+// Copyright XyloIsCoding 2024
+
+
+#include "Inventory/XIUInventoryWorldSubsystem.h"
+
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
+#include "Engine/World.h"
+#include "Inventory/XIUInventoryComponent.h"
+
+
+FXIUInventoryCommand FXIUInventoryCommand::MakeAdd(const TWeakObjectPtr<UXIUInventoryComponent>& Inventory, UXIUItemDefinition* ItemDefinition, const int32 Count)
+{
+	FXIUInventoryCommand Command;
+	Command.Type = EXIUInventoryCommandType::Add;
+	Command.Inventory = Inventory;
+	Command.ItemDefinition = ItemDefinition;
+	Command.Count = Count;
+	return Command;
+}
+
+FXIUInventoryCommand FXIUInventoryCommand::MakeConsume(const TWeakObjectPtr<UXIUInventoryComponent>& Inventory, UXIUItemDefinition* ItemDefinition, const int32 Count)
+{
+	FXIUInventoryCommand Command;
+	Command.Type = EXIUInventoryCommandType::Consume;
+	Command.Inventory = Inventory;
+	Command.ItemDefinition = ItemDefinition;
+	Command.Count = Count;
+	return Command;
+}
+
+FXIUInventoryCommand FXIUInventoryCommand::MakeMove(const TWeakObjectPtr<UXIUInventoryComponent>& Inventory, const int32 SlotIndex, const TWeakObjectPtr<UXIUInventoryComponent>& TargetInventory, const int32 Count)
+{
+	FXIUInventoryCommand Command;
+	Command.Type = EXIUInventoryCommandType::Move;
+	Command.Inventory = Inventory;
+	Command.SlotIndex = SlotIndex;
+	Command.TargetInventory = TargetInventory;
+	Command.Count = Count;
+	return Command;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void UXIUInventoryWorldSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &ThisClass::OnWorldPostActorTick);
+}
+
+void UXIUInventoryWorldSubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+	
+	// nobody waiting on these should be left hanging
+	FXIUInventoryCommand Command;
+	while (PendingCommands.Dequeue(Command))
+	{
+		if (Command.OnCompleted) Command.OnCompleted(0);
+	}
+	
+	Super::Deinitialize();
+}
+
+void UXIUInventoryWorldSubsystem::RegisterInventory(UXIUInventoryComponent* Inventory)
+{
+	if (Inventory) Inventories.AddUnique(Inventory);
+}
+
+void UXIUInventoryWorldSubsystem::UnregisterInventory(UXIUInventoryComponent* Inventory)
+{
+	Inventories.RemoveSwap(Inventory);
+}
+
+FXIUInventoryQueryResult UXIUInventoryWorldSubsystem::RunQuery(const FXIUInventoryQuery& Query) const
+{
+	return Evaluate(MakeSnapshot(Query.Bounds), Query);
+}
+
+TFuture<FXIUInventoryQueryResult> UXIUInventoryWorldSubsystem::RunQueryAsync(FXIUInventoryQuery Query) const
+{
+	FSnapshot Snapshot = MakeSnapshot(Query.Bounds);
+	return Async(EAsyncExecution::TaskGraph, [Snapshot = MoveTemp(Snapshot), Query = MoveTemp(Query)]()
+	{
+		return Evaluate(Snapshot, Query);
+	});
+}
+
+int64 UXIUInventoryWorldSubsystem::CountItemsByDefinition(UXIUItemDefinition* ItemDefinition, const FBox& Bounds) const
+{
+	FXIUInventoryQuery Query;
+	Query.Definitions.Add(ItemDefinition);
+	Query.Bounds = Bounds;
+	return RunQuery(Query).Counts[0];
+}
+
+TArray<UXIUInventoryComponent*> UXIUInventoryWorldSubsystem::FindInventoriesWithItem(UXIUItemDefinition* ItemDefinition, const FBox& Bounds) const
+{
+	FXIUInventoryQuery Query;
+	Query.Definitions.Add(ItemDefinition);
+	Query.Bounds = Bounds;
+	Query.bFindContainers = true;
+	
+	TArray<UXIUInventoryComponent*> Found;
+	for (const TWeakObjectPtr<UXIUInventoryComponent>& Inventory : RunQuery(Query).Containers[0])
+	{
+		if (Inventory.IsValid()) Found.Add(Inventory.Get());
+	}
+	return Found;
+}
+
+double UXIUInventoryWorldSubsystem::GetTotalValue(const TMap<UXIUItemDefinition*, double>& Values, const FBox& Bounds) const
+{
+	FXIUInventoryQuery Query;
+	Query.Bounds = Bounds;
+	for (const TPair<UXIUItemDefinition*, double>& Value : Values)
+	{
+		Query.Values.Add(Value.Key, Value.Value);
+	}
+	return RunQuery(Query).TotalValue;
+}
+
+UXIUInventoryWorldSubsystem::FSnapshot UXIUInventoryWorldSubsystem::MakeSnapshot(const FBox& Bounds) const
+{
+	check(IsInGameThread());
+	
+	FSnapshot Snapshot;
+	Snapshot.Inventories.Reserve(Inventories.Num());
+	Snapshot.ItemOffsets.Reserve(Inventories.Num() + 1);
+	for (const TWeakObjectPtr<UXIUInventoryComponent>& WeakInventory : Inventories)
+	{
+		const UXIUInventoryComponent* Inventory = WeakInventory.Get();
+		if (!Inventory) continue;
+		if (Bounds.IsValid && (!Inventory->GetOwner() || !Bounds.IsInsideOrOn(Inventory->GetOwner()->GetActorLocation()))) continue;
+
+		Snapshot.Inventories.Add(WeakInventory);
+		Snapshot.ItemOffsets.Add(Snapshot.Items.Num());
+		Inventory->GatherItemCounts(Snapshot.Items);
+	}
+	Snapshot.ItemOffsets.Add(Snapshot.Items.Num());
+	return Snapshot;
+}
+
+FXIUInventoryQueryResult UXIUInventoryWorldSubsystem::Evaluate(const FSnapshot& Snapshot, const FXIUInventoryQuery& Query)
+{
+	const int32 NumInventories = Snapshot.Inventories.Num();
+	const int32 NumDefinitions = Query.Definitions.Num();
+
+	// every task only writes its own part of these, so no lock is needed
+	TArray<int64> InventoryCounts;
+	InventoryCounts.SetNumZeroed(NumInventories * NumDefinitions);
+	TArray<double> InventoryValues;
+	InventoryValues.SetNumZeroed(NumInventories);
+
+	ParallelFor(NumInventories, [&](const int32 InventoryIndex)
+	{
+		int64* Counts = InventoryCounts.GetData() + InventoryIndex * NumDefinitions;
+		double Value = 0.0;
+		for (int32 ItemIndex = Snapshot.ItemOffsets[InventoryIndex]; ItemIndex < Snapshot.ItemOffsets[InventoryIndex + 1]; ItemIndex++)
+		{
+			const TPair<const UXIUItemDefinition*, int32>& Item = Snapshot.Items[ItemIndex];
+			const int32 DefinitionIndex = Query.Definitions.IndexOfByKey(Item.Key);
+			if (DefinitionIndex != INDEX_NONE) Counts[DefinitionIndex] += Item.Value;
+			if (const double* ItemValue = Query.Values.Find(Item.Key)) Value += *ItemValue * Item.Value;
+		}
+		InventoryValues[InventoryIndex] = Value;
+	});
+
+	// merge
+	FXIUInventoryQueryResult Result;
+	Result.InventoriesVisited = NumInventories;
+	Result.Counts.SetNumZeroed(NumDefinitions);
+	Result.Containers.SetNum(NumDefinitions);
+	for (int32 InventoryIndex = 0; InventoryIndex < NumInventories; InventoryIndex++)
+	{
+		Result.TotalValue += InventoryValues[InventoryIndex];
+		for (int32 DefinitionIndex = 0; DefinitionIndex < NumDefinitions; DefinitionIndex++)
+		{
+			const int64 Count = InventoryCounts[InventoryIndex * NumDefinitions + DefinitionIndex];
+			Result.Counts[DefinitionIndex] += Count;
+			if (Query.bFindContainers && Count > 0)
+			{
+				Result.Containers[DefinitionIndex].Add(Snapshot.Inventories[InventoryIndex]);
+			}
+		}
+	}
+	return Result;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Commands */
+
+void UXIUInventoryWorldSubsystem::EnqueueCommand(FXIUInventoryCommand&& Command)
+{
+	PendingCommands.Enqueue(MoveTemp(Command));
+}
+
+TFuture<int32> UXIUInventoryWorldSubsystem::EnqueueCommandWithFuture(FXIUInventoryCommand&& Command)
+{
+	TSharedRef<TPromise<int32>> Promise = MakeShared<TPromise<int32>>();
+	TFuture<int32> Future = Promise->GetFuture();
+	Command.OnCompleted = [Promise, OnCompleted = MoveTemp(Command.OnCompleted)](const int32 Result)
+	{
+		if (OnCompleted) OnCompleted(Result);
+		Promise->SetValue(Result);
+	};
+	EnqueueCommand(MoveTemp(Command));
+	return Future;
+}
+
+void UXIUInventoryWorldSubsystem::FlushCommands()
+{
+	check(IsInGameThread());
+	if (PendingCommands.IsEmpty()) return;
+
+	// only what is queued now gets applied, commands queued by the callbacks wait for the next flush
+	TArray<FXIUInventoryCommand> Commands;
+	FXIUInventoryCommand Command;
+	while (PendingCommands.Dequeue(Command))
+	{
+		Commands.Add(MoveTemp(Command));
+	}
+
+	// group by inventory, keeping the order in which the commands of each inventory were queued. Groups run in the
+	// order their inventory first appears in the queue, so the result does not depend on where objects are allocated
+	TMap<UXIUInventoryComponent*, int32> GroupIndexes;
+	TArray<TPair<UXIUInventoryComponent*, TArray<int32>>> Groups;
+	for (int32 CommandIndex = 0; CommandIndex < Commands.Num(); CommandIndex++)
+	{
+		UXIUInventoryComponent* Inventory = Commands[CommandIndex].Inventory.Get();
+		const int32* GroupIndex = GroupIndexes.Find(Inventory);
+		if (!GroupIndex)
+		{
+			GroupIndex = &GroupIndexes.Add(Inventory, Groups.Num());
+			Groups.Emplace(Inventory, TArray<int32>());
+		}
+		Groups[*GroupIndex].Value.Add(CommandIndex);
+	}
+
+	TArray<FXIUInventoryCommand> Batch;
+	for (const TPair<UXIUInventoryComponent*, TArray<int32>>& Group : Groups)
+	{
+		UXIUInventoryComponent* Inventory = Group.Key;
+		Batch.Reset();
+		for (const int32 CommandIndex : Group.Value)
+		{
+			Batch.Add(MoveTemp(Commands[CommandIndex]));
+		}
+
+		if (Inventory)
+		{
+			Inventory->ExecuteCommands(Batch);
+			continue;
+		}
+		for (FXIUInventoryCommand& Dropped : Batch)
+		{
+			if (Dropped.OnCompleted) Dropped.OnCompleted(0);
+		}
+	}
+}
+
+void UXIUInventoryWorldSubsystem::OnWorldPostActorTick(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds)
+{
+	if (InWorld == GetWorld()) FlushCommands();
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
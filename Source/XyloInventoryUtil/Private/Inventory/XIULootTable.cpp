@@ -0,0 +1,237 @@
+// Copyright XyloIsCoding 2024
+
+
+#include "Inventory/XIULootTable.h"
+
+#include "Async/Async.h"
+
+
+/** Immutable once built, so it can be shared between threads and between the tables nesting it */
+struct FXIULootTableCompiled
+{
+	struct FEntry
+	{
+		UXIUItemDefinition* ItemDefinition = nullptr;
+		TSharedPtr<const FXIULootTableCompiled> Nested;
+		/** Only used to know when the nested table changed (never dereferenced off game thread) */
+		const UXIULootTable* NestedTable = nullptr;
+		uint32 NestedVersion = 0;
+		int32 MinCount = 1;
+		int32 MaxCount = 1;
+	};
+
+	TArray<FEntry> Entries;
+	FXIULootAliasTable AliasTable;
+	int32 MinRolls = 0;
+	int32 MaxRolls = 0;
+};
+
+namespace XIULootTable
+{
+	static void Roll(const FXIULootTableCompiled& Compiled, const FRandomStream& Stream, TArray<FXIUItemDefault>& OutItems, TMap<const UXIUItemDefinition*, int32>& ItemIndices)
+	{
+		if (Compiled.AliasTable.IsEmpty()) return;
+
+		const int32 Rolls = Stream.RandRange(Compiled.MinRolls, Compiled.MaxRolls);
+		for (int32 RollIndex = 0; RollIndex < Rolls; RollIndex++)
+		{
+			const FXIULootTableCompiled::FEntry& Entry = Compiled.Entries[Compiled.AliasTable.Sample(Stream)];
+			const int32 Count = Stream.RandRange(Entry.MinCount, Entry.MaxCount);
+			if (Entry.Nested)
+			{
+				for (int32 NestedIndex = 0; NestedIndex < Count; NestedIndex++)
+				{
+					Roll(*Entry.Nested, Stream, OutItems, ItemIndices);
+				}
+				continue;
+			}
+
+			// one entry per definition, so that the result is applied with as few stacking passes as possible
+			if (const int32* ItemIndex = ItemIndices.Find(Entry.ItemDefinition))
+			{
+				OutItems[*ItemIndex].Count += Count;
+				continue;
+			}
+			ItemIndices.Add(Entry.ItemDefinition, OutItems.Emplace(Entry.ItemDefinition, Count));
+		}
+	}
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * FXIULootAliasTable
+ */
+
+void FXIULootAliasTable::Build(TConstArrayView<float> Weights)
+{
+	Probabilities.Reset();
+	Aliases.Reset();
+
+	double TotalWeight = 0.0;
+	for (const float Weight : Weights)
+	{
+		TotalWeight += FMath::Max(Weight, 0.f);
+	}
+	if (TotalWeight <= 0.0) return;
+
+	const int32 Num = Weights.Num();
+	Probabilities.SetNumUninitialized(Num);
+	Aliases.SetNumUninitialized(Num);
+
+	// Vose: scale weights so that the average is 1, then pair every small column with a large one
+	TArray<double> Scaled;
+	Scaled.SetNumUninitialized(Num);
+	TArray<int32> Small;
+	TArray<int32> Large;
+	for (int32 Index = 0; Index < Num; Index++)
+	{
+		Scaled[Index] = FMath::Max(Weights[Index], 0.f) * Num / TotalWeight;
+		(Scaled[Index] < 1.0 ? Small : Large).Add(Index);
+	}
+	while (!Small.IsEmpty() && !Large.IsEmpty())
+	{
+		const int32 SmallIndex = Small.Pop();
+		const int32 LargeIndex = Large.Pop();
+		Probabilities[SmallIndex] = Scaled[SmallIndex];
+		Aliases[SmallIndex] = LargeIndex;
+		Scaled[LargeIndex] = Scaled[LargeIndex] + Scaled[SmallIndex] - 1.0;
+		(Scaled[LargeIndex] < 1.0 ? Small : Large).Add(LargeIndex);
+	}
+	// whatever is left is 1 (up to rounding errors)
+	for (const int32 Index : Large)
+	{
+		Probabilities[Index] = 1.f;
+		Aliases[Index] = Index;
+	}
+	for (const int32 Index : Small)
+	{
+		Probabilities[Index] = 1.f;
+		Aliases[Index] = Index;
+	}
+}
+
+int32 FXIULootAliasTable::Sample(const FRandomStream& Stream) const
+{
+	const int32 Index = Stream.RandHelper(Probabilities.Num());
+	return Stream.GetFraction() < Probabilities[Index] ? Index : Aliases[Index];
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * UXIULootTable
+ */
+
+#if WITH_EDITOR
+void UXIULootTable::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	Version++;
+	Compiled.Reset();
+}
+#endif
+
+TArray<FXIUItemDefault> UXIULootTable::Evaluate(const int32 Seed)
+{
+	TArray<FXIUItemDefault> Items;
+	if (const TSharedPtr<const FXIULootTableCompiled> CompiledTable = GetCompiled())
+	{
+		EvaluateCompiled(*CompiledTable, Seed, Items);
+	}
+	return Items;
+}
+
+TFuture<TArray<FXIUItemDefault>> UXIULootTable::EvaluateAsync(const int32 Seed)
+{
+	return Async(EAsyncExecution::TaskGraph, [CompiledTable = GetCompiled(), Seed]()
+	{
+		TArray<FXIUItemDefault> Items;
+		if (CompiledTable) EvaluateCompiled(*CompiledTable, Seed, Items);
+		return Items;
+	});
+}
+
+TSharedPtr<const FXIULootTableCompiled> UXIULootTable::GetCompiled()
+{
+	check(IsInGameThread());
+
+	TArray<const UXIULootTable*> CompileStack;
+	return Compile(CompileStack);
+}
+
+void UXIULootTable::EvaluateCompiled(const FXIULootTableCompiled& Compiled, const int32 Seed, TArray<FXIUItemDefault>& OutItems)
+{
+	const FRandomStream Stream(Seed);
+	TMap<const UXIUItemDefinition*, int32> ItemIndices;
+	for (int32 ItemIndex = 0; ItemIndex < OutItems.Num(); ItemIndex++)
+	{
+		ItemIndices.Add(OutItems[ItemIndex].ItemDefinition, ItemIndex);
+	}
+	XIULootTable::Roll(Compiled, Stream, OutItems, ItemIndices);
+}
+
+TSharedPtr<const FXIULootTableCompiled> UXIULootTable::Compile(TArray<const UXIULootTable*>& CompileStack)
+{
+	if (Compiled && !IsCompiledOutdated()) return Compiled;
+	if (CompileStack.Contains(this))
+	{
+		UE_LOG(LogTemp, Error, TEXT("UXIULootTable::Compile -> [%s] nests itself, the nested entry is ignored"), *GetName())
+		return nullptr;
+	}
+	CompileStack.Push(this);
+
+	const TSharedRef<FXIULootTableCompiled> NewCompiled = MakeShared<FXIULootTableCompiled>();
+	NewCompiled->MinRolls = FMath::Max(MinRolls, 0);
+	NewCompiled->MaxRolls = FMath::Max(MaxRolls, NewCompiled->MinRolls);
+
+	TArray<float> Weights;
+	for (const FXIULootTableEntry& Entry : Entries)
+	{
+		if (Entry.Weight <= 0.f) continue;
+
+		FXIULootTableCompiled::FEntry CompiledEntry;
+		CompiledEntry.MinCount = FMath::Max(Entry.MinCount, 1);
+		CompiledEntry.MaxCount = FMath::Max(Entry.MaxCount, CompiledEntry.MinCount);
+		if (Entry.NestedTable)
+		{
+			CompiledEntry.Nested = Entry.NestedTable->Compile(CompileStack);
+			if (!CompiledEntry.Nested) continue;
+			CompiledEntry.NestedTable = Entry.NestedTable;
+			CompiledEntry.NestedVersion = Entry.NestedTable->Version;
+		}
+		else if (Entry.ItemDefinition)
+		{
+			CompiledEntry.ItemDefinition = Entry.ItemDefinition;
+		}
+		else
+		{
+			continue;
+		}
+
+		NewCompiled->Entries.Add(MoveTemp(CompiledEntry));
+		Weights.Add(Entry.Weight);
+	}
+	NewCompiled->AliasTable.Build(Weights);
+
+	CompileStack.Pop();
+	Compiled = NewCompiled;
+	return Compiled;
+}
+
+bool UXIULootTable::IsCompiledOutdated() const
+{
+	if (!Compiled) return true;
+
+#if WITH_EDITOR
+	// tables cannot change outside the editor
+	for (const FXIULootTableCompiled::FEntry& Entry : Compiled->Entries)
+	{
+		if (Entry.NestedTable && (Entry.NestedTable->Version != Entry.NestedVersion || Entry.NestedTable->IsCompiledOutdated())) return true;
+	}
+#endif
+	return false;
+}
@@ -0,0 +1,79 @@
+// Copyright XyloIsCoding 2024
+
+
+#include "Inventory/XIUNetDormancyComponent.h"
+
+#include "TimerManager.h"
+
+
+UXIUNetDormancyComponent::UXIUNetDormancyComponent(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	PrimaryComponentTick.bCanEverTick = false;
+	IdleTime = 5.f;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * UActorComponent Interface
+ */
+
+void UXIUNetDormancyComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (GetOwner()->HasAuthority())
+	{
+		LastWakeTime = GetWorld()->GetTimeSeconds();
+		StartIdleTimer(IdleTime);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * NetDormancyComponent
+ */
+
+void UXIUNetDormancyComponent::Wake()
+{
+	AActor* Owner = GetOwner();
+	if (!Owner || !Owner->HasAuthority() || !GetWorld()) return;
+
+	if (Owner->NetDormancy > DORM_Awake)
+	{
+		// flushes the pending state (inventory component and registered items included) and reopens the channel
+		// until we are idle again
+		Owner->FlushNetDormancy();
+		Owner->SetNetDormancy(DORM_Awake);
+	}
+	LastWakeTime = GetWorld()->GetTimeSeconds();
+	if (!GetWorld()->GetTimerManager().TimerExists(IdleTimerHandle)) StartIdleTimer(IdleTime);
+}
+
+void UXIUNetDormancyComponent::StartIdleTimer(const float Delay)
+{
+	if (IdleTime < 0.f || !GetWorld()) return;
+
+	// even without idle time, the change we were woken for needs to go out before going dormant again
+	if (Delay <= 0.f)
+	{
+		IdleTimerHandle = GetWorld()->GetTimerManager().SetTimerForNextTick(this, &ThisClass::OnIdleTimerExpired);
+		return;
+	}
+	GetWorld()->GetTimerManager().SetTimer(IdleTimerHandle, this, &ThisClass::OnIdleTimerExpired, Delay, false);
+}
+
+void UXIUNetDormancyComponent::OnIdleTimerExpired()
+{
+	// woken while the timer was running, so we wait for what is left of the idle time
+	const float IdleFor = static_cast<float>(GetWorld()->GetTimeSeconds() - LastWakeTime);
+	if (IdleFor < IdleTime)
+	{
+		StartIdleTimer(IdleTime - IdleFor);
+		return;
+	}
+	
+	if (GetOwner()->HasAuthority()) GetOwner()->SetNetDormancy(DORM_DormantAll);
+}
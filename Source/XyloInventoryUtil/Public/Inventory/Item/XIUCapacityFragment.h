@@ -0,0 +1,26 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Inventory/Item/XIUItemDefinition.h"
+#include "XIUCapacityFragment.generated.h"
+
+/**
+ * Weight and volume of a single unit of the item, used by inventories with capacity limits
+ */
+UCLASS()
+class XYLOINVENTORYUTIL_API UXIUCapacityFragment : public UXIUItemFragment
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool NeedsInstanceCreated() const override;
+
+public:
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Capacity", meta = (ClampMin = 0))
+	float Weight = 0.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Capacity", meta = (ClampMin = 0))
+	float Volume = 0.f;
+};
@@ -0,0 +1,116 @@
+// Copyright XyloIsCoding 2024
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Inventory/XIUInventoryComponent.h"
+#include "Inventory/Item/XIUItem.h"
+#include "XIUContainerItem.generated.h"
+
+/**
+ * Item that owns its own inventory list (a bag, a chest in the backpack...).
+ * The contents are only alive while the container sits in an inventory: they are registered to the replicator of the
+ * outermost inventory component, and can only be modified on the server while attached.
+ * Counts by definition and load of the contents are cached and propagated to the list holding the container, so
+ * inventories can count items at any depth without walking the containers.
+ */
+UCLASS(Blueprintable, BlueprintType)
+class XYLOINVENTORYUTIL_API UXIUContainerItem : public UXIUItem
+{
+	GENERATED_BODY()
+
+	friend FXIUInventoryList;
+
+public:
+	UXIUContainerItem(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	/*
+	 * UObject Interface
+	 */
+
+public:
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	virtual void BeginDestroy() override;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	/*
+	 * UXIUItem Interface
+	 */
+
+public:
+	/** Containers never stack, each one has its own contents */
+	virtual bool CanStack(UXIUItem* Item) override;
+	/** The copy gets the contents of this container once it is attached to an inventory */
+	virtual UXIUItem* Duplicate(UObject* Outer) override;
+	virtual void SerializeSnapshotData(FArchive& Ar) override;
+protected:
+	virtual void DestroyActiveState() override;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	/*
+	 * ContainerItem
+	 */
+
+public:
+	UFUNCTION(BlueprintCallable, Category = "Container")
+	bool IsAttached() const { return ParentList != nullptr; }
+	/** @return count of this item inside the container (at any depth). O(1) */
+	UFUNCTION(BlueprintPure, Category = "Container")
+	int32 CountContentsByDefinition(const UXIUItemDefinition* ItemDefinition) const;
+	/** Only tracked by the server */
+	UFUNCTION(BlueprintPure, Category = "Container")
+	float GetContentWeight() const { return ContentLoad.GetWeight(); }
+	/** Only tracked by the server */
+	UFUNCTION(BlueprintPure, Category = "Container")
+	float GetContentVolume() const { return ContentLoad.GetVolume(); }
+
+	const FXIUInventoryList& GetContents() const { return Contents; }
+
+	UFUNCTION(BlueprintCallable, Category = "Container")
+	UXIUItem* GetItemAtSlot(const int32 SlotIndex);
+	/** Server only, and only while the container is in an inventory. @return count that could not be added */
+	UFUNCTION(BlueprintCallable, Category = "Container")
+	int32 AddItemDefault(FXIUItemDefault ItemDefault, TArray<UXIUItem*>& AddedItems);
+	/** Server only, and only while the container is in an inventory. @return count that could not be added */
+	UFUNCTION(BlueprintCallable, Category = "Container")
+	int32 AddItem(UXIUItem* Item, int32 CountOverride, bool bDuplicate, bool bModifyItemCount, UXIUItem*& AddedItem);
+private:
+	bool CanManipulateContents() const;
+
+protected:
+	UPROPERTY(EditDefaultsOnly, Category = "Container", meta = (ClampMin = 0))
+	int32 ContainerSize = 8;
+private:
+	UPROPERTY(Replicated)
+	FXIUInventoryList Contents;
+	/** Settings palette of Contents (see UXIUInventoryComponent::SlotSettingsPalette) */
+	UPROPERTY(ReplicatedUsing = OnRep_ContentsSlotSettings)
+	TArray<FXIUInventorySlotSettings> ContentsSlotSettings;
+	UFUNCTION()
+	void OnRep_ContentsSlotSettings();
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+	/* Attachment */
+
+private:
+	/** Called by the list holding the container, after the aggregates have been reported */
+	void OnAttached();
+	/** Called by Contents when something changed in it. Updates the aggregates and forwards to ParentList */
+	void ApplyContentsDelta(const UXIUItemDefinition* ItemDefinition, const int32 CountDelta, const FXIUInventoryLoad& LoadDelta);
+	/** Called by Contents when its tracking is reset. Removes the aggregates from ParentList */
+	void ResetContentsAggregates();
+	/** List holding this container */
+	FXIUInventoryList* ParentList = nullptr;
+	/** Snapshot of the contents waiting for the container to be attached (set by Duplicate and snapshot load) */
+	TArray<uint8> PendingContents;
+	bool bContentsObserved = false;
+	TMap<const UXIUItemDefinition*, int32> AggregateCounts;
+	FXIUInventoryLoad ContentLoad;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+};
@@ -14,6 +14,9 @@ class XYLOINVENTORYUTIL_API UXIUDropFragment : public UXIUItemFragment
 {
 	GENERATED_BODY()
 
+public:
+	virtual bool NeedsInstanceCreated() const override;
+
 public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Drop", meta = (MustImplement = "/Script/XyloInventoryUtil.XIUPickUpInterface"))
 	TSubclassOf<AActor> ItemDropActor;
@@ -9,6 +9,7 @@
 
 class UXIUItemDefinition;
 class UXIUItem;
+struct FXIUInventoryList;
 
 USTRUCT(BlueprintType)
 struct FXIUItemCountChangeMessage
@@ -81,6 +82,20 @@ struct TStructOpsTypeTraits<FXIUItemDefault> : public TStructOpsTypeTraitsBase2<
 };
 
 
+/** State that is the same for every item of a definition. Owned by the definition (see
+ * UXIUItemDefinition::GetSharedState) and only pointed to by the items, unless an item asks for its own copy with
+ * UXIUItem::GetMutableState */
+struct XYLOINVENTORYUTIL_API FXIUItemSharedState
+{
+	UXIUItemDefinition* ItemDefinition = nullptr;
+	FString ItemName;
+	int32 MaxCount = 1;
+	/** True if a fragment of the definition has side effects on the items it creates (see
+	 * UXIUItemFragment::NeedsInstanceCreated). If false, creating an item never calls the fragments */
+	bool bCallsFragments = false;
+};
+
+
 
 
 /**
@@ -92,6 +107,7 @@ UCLASS(Blueprintable, BlueprintType, Abstract)
 class XYLOINVENTORYUTIL_API UXIUItem : public UXROUReplicatedObject
 {
 	GENERATED_BODY()
+	friend FXIUInventoryList;
 
 public:
 	UXIUItem(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
@@ -104,6 +120,8 @@ public:
 
 public:
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	virtual void BeginDestroy() override;
+	virtual void GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize) override;
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -168,12 +186,28 @@ private:
 
 public:
 	UFUNCTION(BlueprintCallable, Category = "Item")
-	UXIUItemDefinition* GetItemDefinition() const { return ItemDefinition; }
+	UXIUItemDefinition* GetItemDefinition() const { return State ? State->ItemDefinition : nullptr; }
 protected:
 	void SetItemDefinition(UXIUItemDefinition* InItemDefinition);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+	/* Shared State */
+
+public:
+	/** Valid once the item is initialized */
+	const FXIUItemSharedState& GetState() const { return *State; }
+	/** Copy on write: the first call gives this item its own copy of the state shared by the items of its
+	 * definition. The copy is not replicated, so it must be made on server and clients alike (e.g. in
+	 * UXIUItemFragment::OnInstanceCreated, which runs on both) */
+	FXIUItemSharedState& GetMutableState();
+	bool HasOwnState() const { return bOwnsState; }
 private:
-	UPROPERTY()
-	UXIUItemDefinition* ItemDefinition;
+	/** Points to the state of the definition, or to the copy owned by this item if bOwnsState.
+	 * The definition itself is kept alive by ItemInitializer */
+	const FXIUItemSharedState* State = nullptr;
+	bool bOwnsState = false;
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 	
@@ -200,7 +234,28 @@ protected:
 private:
 	UPROPERTY(ReplicatedUsing = OnRep_Count)
 	int32 Count = -1;
-	int32 LastCount = -1;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+	/* Owner */
+
+private:
+	/** List holding this item, notified directly on count change and initialization (before the delegates, which
+	 * are left to external listeners). Set and cleared by the list (see FXIUInventoryList::RegisterSlotChange) */
+	FXIUInventoryList* OwnerList = nullptr;
+	/** Slot of OwnerList holding this item, so the list does not have to look for it */
+	int32 OwnerSlotIndex = INDEX_NONE;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+	/* Snapshot */
+
+public:
+	/** Saves or loads per item data in an inventory snapshot (definition and count are already handled by the
+	 * inventory). Called on an already initialized item. Override in child classes with custom state. */
+	virtual void SerializeSnapshotData(FArchive& Ar);
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 	
@@ -8,6 +8,8 @@
 #include "Inventory/XIUPickUpInterface.h"
 #include "XIUItemActor.generated.h"
 
+class UXIUNetDormancyComponent;
+
 UCLASS()
 class XYLOINVENTORYUTIL_API AXIUItemActor : public AActor, public IXIUPickUpInterface
 {
@@ -39,6 +41,8 @@ public:
 	/** Duplicate the item and set the duplicate as this actor's item (does not touch the input item) */
 	virtual void SetItem_Implementation(UXIUItem* InItem, int32 Count) override;
 	virtual UXIUItem* GetItem_Implementation() override;
+	/** The inventory gets copies of the item (clients received it through the channel of this actor), and the actor
+	 * stays with what did not fit */
 	virtual bool TryPickUp_Implementation(UXIUInventoryComponent* OtherInventory) override;
 	
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -74,6 +78,16 @@ protected:
 
 public:
 	virtual bool TryPickUpInSlot(UXIUInventoryComponent* OtherInventory, const int32 SlotIndex);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+	/* Net Dormancy */
+
+private:
+	/** Woken before modifying the item, so the change is not lost on dormant channels */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, meta = (AllowPrivateAccess))
+	TObjectPtr<UXIUNetDormancyComponent> NetDormancyComponent;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
 	
 
 };
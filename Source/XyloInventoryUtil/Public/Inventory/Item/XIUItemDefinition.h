@@ -4,10 +4,10 @@
 
 #include "CoreMinimal.h"
 #include "Engine/DataAsset.h"
+#include "GameplayTagContainer.h"
+#include "Inventory/Item/XIUItem.h"
 #include "XIUItemDefinition.generated.h"
 
-class UXIUItem;
-
 
 UCLASS(DefaultToInstanced, EditInlineNew, Abstract, Blueprintable)
 class XYLOINVENTORYUTIL_API UXIUItemFragment : public UObject
@@ -17,6 +17,14 @@ class XYLOINVENTORYUTIL_API UXIUItemFragment : public UObject
 public:
 	UFUNCTION(BlueprintNativeEvent)
 	void OnInstanceCreated(UXIUItem* Item) const;
+	/** Items of definitions where no fragment needs OnInstanceCreated skip the fragments entirely when created.
+	 * True if a blueprint implements OnInstanceCreated, and always for native subclasses (an override of
+	 * OnInstanceCreated_Implementation cannot be detected). Native fragments with nothing to do on creation opt out
+	 * by returning IsOnInstanceCreatedImplementedInScript */
+	virtual bool NeedsInstanceCreated() const;
+protected:
+	/** @return true if a blueprint class implements OnInstanceCreated */
+	bool IsOnInstanceCreatedImplementedInScript() const;
 };
 
 /**
@@ -29,6 +37,9 @@ class XYLOINVENTORYUTIL_API UXIUItemDefinition : public UDataAsset
 
 public:
 	UXIUItemDefinition(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
 	
 public:
 	UPROPERTY(EditDefaultsOnly, Category = "Item")
@@ -40,6 +51,10 @@ public:
 	UPROPERTY(EditDefaultsOnly, Category = "Item")
 	int32 MaxCount;
 
+	/** Matched against the tag filters of inventory slots */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Item")
+	FGameplayTagContainer ItemTags;
+
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="Item", Instanced)
 	TArray<TObjectPtr<UXIUItemFragment>> Fragments;
 
@@ -52,4 +67,11 @@ public:
 	{
 		return (ResultClass*)FindFragmentByClass(ResultClass::StaticClass());
 	}
+
+	/** Game thread. Built on first use, then pointed to by every item of this definition. Stays at the same address
+	 * for the lifetime of the definition (edits update it in place) */
+	const FXIUItemSharedState* GetSharedState();
+private:
+	void UpdateSharedState();
+	TUniquePtr<FXIUItemSharedState> SharedState;
 };
@@ -10,6 +10,7 @@
 
 struct FXIUInventorySlotChangeMessage;
 class UXIUInventoryComponent;
+class UXIUNetDormancyComponent;
 struct FXIUItemDefault;
 
 UCLASS()
@@ -52,6 +53,9 @@ public:
 private:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, meta = (AllowPrivateAccess))
 	UXIUInventoryComponent* InventoryComponent;
+	/** Woken by InventoryComponent before its slots or items change (see UXIUInventoryComponent::WakeOwnerNetDormancy) */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, meta = (AllowPrivateAccess))
+	TObjectPtr<UXIUNetDormancyComponent> NetDormancyComponent;
 
 private:
 	bool bInventoryInitialized = false;
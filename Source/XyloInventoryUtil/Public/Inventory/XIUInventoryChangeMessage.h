@@ -14,6 +14,10 @@ struct FXIUInventorySlotChangeMessage
 	UPROPERTY(BlueprintReadOnly, Category=Inventory)
 	TObjectPtr<UActorComponent> InventoryOwner = nullptr;
 
+	/** Container item whose contents changed (Index is a slot of the container), or nullptr for the inventory itself */
+	UPROPERTY(BlueprintReadOnly, Category=Inventory)
+	TObjectPtr<UXIUItem> Container = nullptr;
+
 	UPROPERTY(BlueprintReadOnly, Category=Inventory)
 	int32 Index = 0;
 
@@ -7,12 +7,20 @@
 #include "Inventory/Item/XIUItem.h"
 #include "XROUObjectReplicatorComponent.h"
 #include "Components/ActorComponent.h"
+#include "GameplayTagContainer.h"
 #include "Net/Serialization/FastArraySerializer.h"
+#include "UObject/ObjectKey.h"
 #include "XIUInventoryComponent.generated.h"
 
 
 class AXIUItemActor;
+class FXIUInventoryPageStore;
+class FXIUInventoryJournal;
+class UXIUContainerItem;
+class UXIULootTable;
+class UXIUNetDormancyComponent;
 struct FXIUInventoryList;
+struct FXIUInventoryCommand;
 class UXIUInventoryComponent;
 
 USTRUCT(BlueprintType)
@@ -23,8 +31,30 @@ struct FXIUInventorySlotSettings
 	UPROPERTY(BlueprintReadWrite)
 	TSubclassOf<UXIUItem> Filter;
 
+	/** Item definition must have all these tags */
+	UPROPERTY(BlueprintReadWrite)
+	FGameplayTagContainer RequiredTags;
+
+	/** Item definition must have none of these tags */
+	UPROPERTY(BlueprintReadWrite)
+	FGameplayTagContainer BlockedTags;
+
 	UPROPERTY(BlueprintReadWrite)
 	bool bLocked = false;
+
+	bool operator==(const FXIUInventorySlotSettings& Other) const
+	{
+		return Filter == Other.Filter && bLocked == Other.bLocked && RequiredTags == Other.RequiredTags && BlockedTags == Other.BlockedTags;
+	}
+	bool IsDefault() const { return !Filter && !bLocked && RequiredTags.IsEmpty() && BlockedTags.IsEmpty(); }
+
+	static const FXIUInventorySlotSettings& GetDefault();
+	/** Game thread. Slots only point to interned settings, so every slot with the same settings (in any inventory)
+	 * shares a single copy
+	 * @return interned copy of these settings, or nullptr if they are the default ones */
+	static const FXIUInventorySlotSettings* Intern(const FXIUInventorySlotSettings& Settings);
+	/** @return bytes used by all the interned settings */
+	static SIZE_T GetInternedAllocatedSize();
 };
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -85,36 +115,50 @@ public:
 
 	int32 GetItemCountSafe() const;
 
-	UPROPERTY(NotReplicated)
-	TSoftObjectPtr<UXIUItem> LastObservedItem = nullptr;
-	UPROPERTY(NotReplicated)
+	/** Client bookkeeping of the last replicated state (a weak pointer, since the item might get destroyed first) */
+	TWeakObjectPtr<UXIUItem> LastObservedItem = nullptr;
 	int32 LastObservedCount = INDEX_NONE;
 	
 /*--------------------------------------------------------------------------------------------------------------------*/
 
 /*--------------------------------------------------------------------------------------------------------------------*/
-	/* Filter */
-	
+	/* Settings */
+
 private:
+	/** Index in the settings palette of the list (0 means default settings). Only the index is replicated, filter
+	 * and lock are cold data shared by every slot using them */
 	UPROPERTY()
-	TSubclassOf<UXIUItem> Filter = nullptr;
+	uint16 SettingsIndex = 0;
+	/** Interned settings (nullptr means default settings). Set by FXIUInventoryList::ApplySlotSettings on server,
+	 * and resolved from SettingsIndex on client */
+	const FXIUInventorySlotSettings* Settings = nullptr;
+public:
+	const FXIUInventorySlotSettings& GetSettings() const { return Settings ? *Settings : FXIUInventorySlotSettings::GetDefault(); }
+	uint16 GetSettingsIndex() const { return SettingsIndex; }
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+	/* Filter */
+	
 public:
-	void SetFilter(const TSubclassOf<UXIUItem> NewFilter);
-	TSubclassOf<UXIUItem> GetFilter() const { return Filter; }
+	TSubclassOf<UXIUItem> GetFilter() const { return GetSettings().Filter; }
+	const FGameplayTagContainer& GetRequiredTags() const { return GetSettings().RequiredTags; }
+	const FGameplayTagContainer& GetBlockedTags() const { return GetSettings().BlockedTags; }
+	bool HasTagFilter() const { return !GetRequiredTags().IsEmpty() || !GetBlockedTags().IsEmpty(); }
+	/** Checks both class and tag filter */
 	bool MatchesFilter(const UXIUItem* TestItem) const;
+	/** Only checks the class filter */
 	bool MatchesFilterByClass(const TSubclassOf<UXIUItem> TestItem) const;
+	bool MatchesTags(const UXIUItemDefinition* TestItemDefinition) const;
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 	
 /*--------------------------------------------------------------------------------------------------------------------*/
 	/* Locked */
 	
-private:
-	UPROPERTY()
-	bool bLocked = false;
 public:
-	void SetLocked(bool NewLock);
-	bool IsLocked() const { return bLocked; }
+	bool IsLocked() const { return GetSettings().bLocked; }
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 
@@ -123,7 +167,6 @@ public:
 
 public:
 	bool CanInsertItem(UXIUItem* TestItem) const;
-	void ApplySettings(const FXIUInventorySlotSettings& SlotSettings);
 	
 /*--------------------------------------------------------------------------------------------------------------------*/
 
@@ -132,6 +175,250 @@ public:
 };
 
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/*--------------------------------------------------------------------------------------------------------------------*/
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * FXIUInventoryPage
+ */
+
+UENUM()
+enum class EXIUInventoryPageState : uint8
+{
+	/** page was never written to: all its slots are empty, with default settings, and cost nothing */
+	Unallocated,
+	/** page slots are in the inventory entries */
+	Resident,
+	/** page slots are in the page store, and get loaded back on access */
+	Stored
+};
+
+/** Paging settings of an inventory, replicated so that clients know the real size of a paged inventory */
+USTRUCT()
+struct FXIUInventoryPagingInfo
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	int32 SlotsPerPage = 0;
+
+	UPROPERTY()
+	int32 SlotCount = 0;
+};
+
+/** What the client knows about a page of an inventory using windowed replication, even if it is not visible */
+USTRUCT(BlueprintType)
+struct FXIUInventoryPageSummary
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Inventory")
+	uint16 OccupiedSlots = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Inventory")
+	int32 TotalCount = 0;
+};
+
+/** Weight and volume of items, in fixed point (1/100 of a unit), so that incremental totals never drift */
+USTRUCT(BlueprintType)
+struct FXIUInventoryLoad
+{
+	GENERATED_BODY()
+
+	static constexpr float UnitScale = 100.f;
+
+	FXIUInventoryLoad()
+	{
+	}
+
+	FXIUInventoryLoad(const int64 InWeight, const int64 InVolume)
+		: Weight(InWeight),
+		  Volume(InVolume)
+	{
+	}
+	
+	int64 Weight = 0;
+	int64 Volume = 0;
+
+	static FXIUInventoryLoad FromUnits(const float InWeight, const float InVolume)
+	{
+		return FXIUInventoryLoad(FMath::RoundToInt64(InWeight * UnitScale), FMath::RoundToInt64(InVolume * UnitScale));
+	}
+	float GetWeight() const { return Weight / UnitScale; }
+	float GetVolume() const { return Volume / UnitScale; }
+	bool IsZero() const { return Weight == 0 && Volume == 0; }
+
+	FXIUInventoryLoad operator+(const FXIUInventoryLoad& Other) const { return FXIUInventoryLoad(Weight + Other.Weight, Volume + Other.Volume); }
+	FXIUInventoryLoad operator-(const FXIUInventoryLoad& Other) const { return FXIUInventoryLoad(Weight - Other.Weight, Volume - Other.Volume); }
+	FXIUInventoryLoad operator*(const int32 Count) const { return FXIUInventoryLoad(Weight * Count, Volume * Count); }
+	FXIUInventoryLoad& operator+=(const FXIUInventoryLoad& Other) { Weight += Other.Weight; Volume += Other.Volume; return *this; }
+	bool operator==(const FXIUInventoryLoad& Other) const { return Weight == Other.Weight && Volume == Other.Volume; }
+
+	/** Both values are sent packed in a single property */
+	bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FXIUInventoryLoad> : public TStructOpsTypeTraitsBase2<FXIUInventoryLoad>
+{
+	enum
+	{
+		WithNetSerializer = true,
+		// members are not properties, so replication needs this to notice changes
+		WithIdenticalViaEquality = true
+	};
+};
+
+/** Current load and limits of an inventory, sent packed in a single property */
+USTRUCT()
+struct FXIUInventoryCapacity
+{
+	GENERATED_BODY()
+
+	FXIUInventoryLoad CurrentLoad;
+	/** 0 means no limit */
+	FXIUInventoryLoad MaxLoad;
+
+	bool operator==(const FXIUInventoryCapacity& Other) const { return CurrentLoad == Other.CurrentLoad && MaxLoad == Other.MaxLoad; }
+	bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FXIUInventoryCapacity> : public TStructOpsTypeTraitsBase2<FXIUInventoryCapacity>
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithIdenticalViaEquality = true
+	};
+};
+
+/** Slots of an inventory that share the same filter. Tag filters are compiled to masks over the tags used by the
+ * tag filters of the inventory, so matching an item definition is a couple of bitwise operations */
+struct FXIUInventoryFilterGroup
+{
+	const UClass* Filter = nullptr;
+	FGameplayTagContainer RequiredTags;
+	FGameplayTagContainer BlockedTags;
+	uint64 RequiredTagMask = 0;
+	uint64 BlockedTagMask = 0;
+
+	bool HasSameFilter(const FXIUInventorySlot& Slot) const
+	{
+		return Filter == Slot.GetFilter() && RequiredTags == Slot.GetRequiredTags() && BlockedTags == Slot.GetBlockedTags();
+	}
+	bool HasTagFilter() const { return !RequiredTags.IsEmpty() || !BlockedTags.IsEmpty(); }
+};
+
+/** Empty and unlocked slots of a stored page sharing the same filter (tag masks are not used) */
+struct FXIUInventoryStoredFreeSlots
+{
+	FXIUInventoryFilterGroup Group;
+	int32 Count = 0;
+};
+
+/** Server side bookkeeping of a page of a paged inventory */
+USTRUCT()
+struct FXIUInventoryPage
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	EXIUInventoryPageState State = EXIUInventoryPageState::Unallocated;
+
+	/** definitions and total counts of the items of a stored page, to answer queries without loading it */
+	UPROPERTY()
+	TArray<FXIUItemDefault> StoredItems;
+
+	/** definitions and total counts of the items inside the containers of a stored page. These stay in the nested
+	 * counts of the list while the page is stored */
+	UPROPERTY()
+	TArray<FXIUItemDefault> StoredNestedItems;
+
+	/** load of the contents of the containers of a stored page, which stays in the load of the list */
+	FXIUInventoryLoad StoredNestedLoad;
+
+	/** free space of the unlocked partial stacks of a stored page, by definition */
+	UPROPERTY()
+	TArray<FXIUItemDefault> StoredStackSpace;
+
+	/** empty and unlocked slots of a stored page, by filter */
+	TArray<FXIUInventoryStoredFreeSlots> StoredFreeSlotGroups;
+
+	/** empty and unlocked slots of a stored page */
+	int32 StoredFreeSlots = 0;
+
+	double LastAccessTime = 0.0;
+};
+
+/** Where the count of an item goes when added to an inventory: existing stacks first (in slot order), then as many
+ * new stacks as needed in empty slots (see FXIUInventoryList::PlanPlacement) */
+struct FXIUInventoryPlacementPlan
+{
+	struct FPlacement
+	{
+		int32 EntryIndex = INDEX_NONE;
+		int32 Count = 0;
+	};
+
+	/** Existing stacks getting count */
+	TArray<FPlacement, TInlineAllocator<8>> TopUps;
+	/** Empty slots getting a new stack */
+	TArray<FPlacement, TInlineAllocator<8>> NewStacks;
+	/** Count that fits in no resident slot */
+	int32 Leftover = 0;
+
+	void Reset()
+	{
+		TopUps.Reset();
+		NewStacks.Reset();
+		Leftover = 0;
+	}
+};
+
+/** Bytes used by an inventory, to budget memory per container type (see UXIUInventoryComponent::GetMemoryReport) */
+USTRUCT(BlueprintType)
+struct FXIUInventoryMemoryReport
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Inventory")
+	int32 SlotCount = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Inventory")
+	int32 OccupiedSlotCount = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Inventory")
+	int32 ItemCount = 0;
+
+	/** Items registered to the replicator as subobjects */
+	UPROPERTY(BlueprintReadOnly, Category = "Inventory")
+	int32 ReplicatedItemCount = 0;
+
+	/** Objects bound to the item delegates (external listeners only, the inventory is notified directly) */
+	UPROPERTY(BlueprintReadOnly, Category = "Inventory")
+	int32 DelegateBindingCount = 0;
+
+	/** Slot arrays and per slot bookkeeping (tracking, generations, filter groups, caches) */
+	UPROPERTY(BlueprintReadOnly, Category = "Inventory")
+	int64 SlotBytes = 0;
+
+	/** Item objects (including what UObject::GetResourceSizeEx reports for them) */
+	UPROPERTY(BlueprintReadOnly, Category = "Inventory")
+	int64 ItemBytes = 0;
+
+	/** Invocation lists of the item delegates */
+	UPROPERTY(BlueprintReadOnly, Category = "Inventory")
+	int64 DelegateBytes = 0;
+
+	/** Settings palettes (interned settings are shared by every inventory, so they are not counted) */
+	UPROPERTY(BlueprintReadOnly, Category = "Inventory")
+	int64 SettingsBytes = 0;
+
+	int64 GetTotalBytes() const { return SlotBytes + ItemBytes + DelegateBytes + SettingsBytes; }
+};
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /*--------------------------------------------------------------------------------------------------------------------*/
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -158,6 +445,11 @@ public:
     }
 
 private:
+	friend UXIUContainerItem;
+	friend UXIUItem;
+	
+	/** Component hosting this list. For the contents of a container, it is the component holding the container
+	 * (directly or through other containers), and it is only set once the container is in an inventory */
 	UPROPERTY(NotReplicated)
 	TObjectPtr<UXIUInventoryComponent> OwnerComponent;
 	
@@ -169,16 +461,23 @@ private:
 	/* FFastArraySerializer contract */
 	
 public:
-	/* Calls BroadcastChangeMessage, and calls UnBindItemCountChangedDelegate on the items of the removed slots */
+	/* Calls BroadcastChangeMessage, and clears the owner of the items of the removed slots */
 	void PreReplicatedRemove(const TArrayView<int32>& RemovedIndices, int32 FinalSize);
-	/* Calls BroadcastChangeMessage, and calls BindItemCountChangedDelegate on the items of the added slots */
+	/* Calls BroadcastChangeMessage, and sets the owner of the items of the added slots */
 	void PostReplicatedAdd(const TArrayView<int32>& AddedIndices, int32 FinalSize);
-	/* Calls BroadcastChangeMessage, and, if item changed, calls BindItemCountChangedDelegate on the new items, and UnBind on the old one */
+	/* Calls BroadcastChangeMessage, and, if item changed, sets the owner of the new items, and clears the one of the old ones */
 	void PostReplicatedChange(const TArrayView<int32>& ChangedIndices, int32 FinalSize);
 
-	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	/** Also records the bytes written on server (see GetReplicatedBytes) */
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms);
+
+	/** Slots outside the replication window are skipped, which the delta logic sees as a removal on client. They
+	 * are sent again as new slots once they are back in the window */
+	template<typename Type, typename SerializerType>
+	bool ShouldWriteFastArrayItem(const Type& Item, const bool bIsWritingOnClient)
 	{
-		return FFastArraySerializer::FastArrayDeltaSerialize<FXIUInventorySlot, FXIUInventoryList>(Entries, DeltaParms, *this);
+		if (bIsWritingOnClient) return Item.ReplicationID != INDEX_NONE;
+		return ShouldReplicateSlot(Item.GetIndex());
 	}
 
 /*--------------------------------------------------------------------------------------------------------------------*/
@@ -188,13 +487,96 @@ public:
 	/* Helpers */
 	
 public:
+	/** Broadcasts the change, or queues it if a change batch is open */
 	void BroadcastChangeMessage(const FXIUInventorySlot& Entry, const int32 OldCount, const int32 NewCount, UXIUItem* OldItem) const;
+	/** Change messages of a batch are broadcast together when the outermost batch ends, so listeners never see (nor
+	 * act on) the inventory in the middle of a multi slot operation. Batches can be nested */
+	void BeginChangeBatch();
+	void EndChangeBatch();
 private:
 	bool CanManipulateInventory() const;
+	int32 ChangeBatchDepth = 0;
+	mutable TArray<FXIUInventorySlotChangeMessage> PendingChangeMessages;
 
 public:
-	int32 GetSize() const { return Entries.Num(); }
+	int32 GetSize() const { return IsPaged() ? PagedSlotCount : Entries.Num(); }
+	/** With paged storage, only contains the slots of resident pages (use FXIUInventorySlot::GetIndex) */
 	const TArray<FXIUInventorySlot>& GetInventory() const { return Entries; };
+	/** @return slot with this index, or nullptr if it does not exist (or is not resident) */
+	const FXIUInventorySlot* FindSlot(const int32 SlotIndex) const;
+	FXIUInventorySlot* FindSlot(const int32 SlotIndex);
+private:
+	/** Slot index to entry index, used when slots are not stored in index order */
+	mutable TMap<int32, int32> SlotToEntryCache;
+	mutable uint32 CachedSlotLayoutVersion = 0;
+	/** incremented every time entries are added or removed */
+	uint32 SlotLayoutVersion = 1;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+	/* Filter cache */
+	
+public:
+	/** Must be called after changing the filter of a slot of this list */
+	void InvalidateFilterGroups();
+	/** Same as FXIUInventorySlot::MatchesFilterByClass, answered from a table built lazily per (filter, item class) */
+	bool IsFilterCompatible(const UClass* Filter, const UClass* ItemClass) const;
+	/** Same as FXIUInventorySlot::CanInsertItem, but the filter is checked through the filter groups */
+	bool CanInsertItemInSlot(const FXIUInventorySlot& Slot, UXIUItem* TestItem) const;
+	/** Slots are grouped by filter, so a single check answers every slot of a group.
+	 * @param OutGroupMatches for each filter group, true if it accepts the item. Use with GetEntryFilterGroup */
+	void MatchFilterGroups(const UXIUItemDefinition* ItemDefinition, const UClass* ItemClass, TArray<bool, TInlineAllocator<8>>& OutGroupMatches) const;
+	/** @return filter group of an entry (index in Entries, not slot index). Only valid after MatchFilterGroups,
+	 * until entries or filters change */
+	int32 GetEntryFilterGroup(const int32 EntryIndex) const { return EntryFilterGroups[EntryIndex]; }
+	/** @return true if any slot can receive count of this item */
+	bool CanInsertItem(UXIUItem* TestItem) const;
+private:
+	/** Same as FXIUInventorySlot::SetItem, but the filter is checked through the compatibility table */
+	bool SetSlotItem(FXIUInventorySlot& Slot, UXIUItem* NewItem, UXIUItem*& OldItem);
+	void UpdateFilterGroups() const;
+	bool MatchesFilterGroup(const FXIUInventoryFilterGroup& Group, const UXIUItemDefinition* ItemDefinition, const UClass* ItemClass) const;
+	/** Same as MatchesFilterGroup, checking tags on the containers, for groups kept outside FilterGroups */
+	bool MatchesGroupFilter(const FXIUInventoryFilterGroup& Group, const UXIUItemDefinition* ItemDefinition, const UClass* ItemClass) const;
+	/** @return bits of FilterTags that the definition has (parent tags match too) */
+	uint64 GetDefinitionTagMask(const UXIUItemDefinition* ItemDefinition) const;
+	/** class hierarchies do not change, so this never needs to be invalidated (keys are safe against class reuse) */
+	mutable TMap<TPair<TObjectKey<UClass>, TObjectKey<UClass>>, bool> FilterCompatibility;
+	mutable TArray<FXIUInventoryFilterGroup> FilterGroups;
+	/** tags used by tag filters. The index of a tag is its bit in the masks */
+	mutable TArray<FGameplayTag> FilterTags;
+	/** too many tags for the masks, so tag filters are checked on the containers */
+	mutable bool bFilterTagsOverflow = false;
+	/** reset when FilterTags changes */
+	mutable TMap<TObjectKey<UXIUItemDefinition>, uint64> DefinitionTagMasks;
+	/** filter group of each entry */
+	mutable TArray<int32> EntryFilterGroups;
+	mutable uint32 FilterGroupsLayoutVersion = 0;
+	mutable bool bFilterGroupsDirty = true;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+	/* Slot settings */
+
+public:
+	/** Server. Points the slot to the interned settings, and replicates only their index in the settings palette of
+	 * the owner. If the slot is in a list, InvalidateFilterGroups and MarkItemDirty need to be called after this */
+	void ApplySlotSettings(FXIUInventorySlot& Slot, const FXIUInventorySlotSettings& Settings);
+	/** Client. Called when the settings palette replicates, so slots which arrived before their settings get
+	 * broadcast again with the right filter and lock */
+	void OnSettingsPaletteReplicated();
+private:
+	/** Palettes are append only, and owned by the container holding this list, or by the owner component */
+	TArray<FXIUInventorySlotSettings>* GetSettingsPalette() const;
+	/** @return index to replicate for these settings (0 for default settings) */
+	uint16 AddToSettingsPalette(const FXIUInventorySlotSettings& Settings);
+	/** Client. Points the slot to the interned settings of its SettingsIndex
+	 * @return true if the settings of the slot changed */
+	bool ResolveSlotSettings(FXIUInventorySlot& Slot);
+	/** Client. Interned settings of each palette entry, resolved lazily */
+	TArray<const FXIUInventorySlotSettings*> ResolvedPalette;
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 	
@@ -211,16 +593,30 @@ public:
 	 * @param AddedItems: pointers to added items
 	 * @return Count of this item which was not added */
 	int32 AddItemDefault(FXIUItemDefault ItemDefault, TArray<UXIUItem*>& AddedItems);
-	/** Add an item
+	/** Add an item. Without bDuplicate, Item itself is placed only if it is outered to the owner of this inventory
+	 * (clients got it through the same actor channel) and all of its count gets added. Otherwise copies are placed,
+	 * and Item keeps what was not added
 	 * @param Item: item to add (count is decreased to match the amount that was added to inventory, unless
 	 *				bModifyItemCount is true)
 	 * @param CountOverride
 	 * @param bDuplicate: set to true if the Item was not created using this component
 	 * @param bModifyItemCount: modify count of item passed as input
-	 * @param AddedItem: pointer to added item
+	 * @param AddedItem: pointer to the first new stack (existing stacks topped up are not reported)
 	 * @return Count of this item which was not added */
 	int32 AddItem(UXIUItem* Item, int32 CountOverride, bool bDuplicate, bool bModifyItemCount, UXIUItem*& AddedItem);
-
+	/** Plans where Count of an item goes, in a single pass over the resident slots. Does not modify anything
+	 * @param Item: if set, its stacking rules and max count are used instead of the ones of ItemDefinition */
+	void PlanPlacement(const UXIUItemDefinition* ItemDefinition, UXIUItem* Item, const int32 Count, FXIUInventoryPlacementPlan& OutPlan) const;
+	/** Stacking rule used by PlanPlacement: CanStack of the slot item if an item is given, otherwise the definition
+	 * (items made from a default only differ by definition) */
+	static bool CanStackOnSlotItem(UXIUItem* SlotItem, const UXIUItemDefinition* ItemDefinition, UXIUItem* Item);
+private:
+	/** Applies a plan made by PlanPlacement (should be in a change batch, so listeners cannot invalidate it)
+	 * @param MakeStack: called once per new stack with its count and the count placed so far, in slot order
+	 * @param DiscardStack: called with a stack made by MakeStack which could not be placed, to undo what making it did
+	 * @return count actually placed */
+	int32 CommitPlacement(const FXIUInventoryPlacementPlan& Plan, TFunctionRef<UXIUItem*(int32, int32)> MakeStack, TFunctionRef<void(UXIUItem*)> DiscardStack, TArray<UXIUItem*>& OutNewItems);
+public:
 	/** Set item in slot
 	 ** @param SlotIndex: Slot to use
 	 * @param Item: item to add
@@ -229,17 +625,36 @@ public:
 	 * @param OldItem: pointer to item that was previously in the slot
 	 * @return true if item got set */
 	bool SetItemAtSlot(int32 SlotIndex, UXIUItem* Item, bool bDuplicate, UXIUItem*& AddedItem, UXIUItem*& OldItem);
-	/** Get item in slot (Already checks IsEmpty on item)
+	/** Get item in slot (Already checks IsEmpty on item). Never touches the disk: the items of stored pages are not
+	 * in memory, so their slots return nullptr
 	 * @return pointer to item at index */
 	UXIUItem* GetItemAtSlot(const int32 SlotIndex);
+	/** Server. Like GetItemAtSlot, but loads the page of the slot back if it is stored (reads the disk, unless the
+	 * page was prefetched). Meant for code about to modify the item */
+	UXIUItem* LoadItemAtSlot(const int32 SlotIndex);
 	/** Remove item at slot
 	 * @return pointer to removed Item */
 	UXIUItem* RemoveItemAtSlot(int32 SlotIndex);
 
-	/** @return true if any item was found (Already checks IsEmpty on items) */
+	/** Items of stored pages are not included
+	 * @return true if any item was found (Already checks IsEmpty on items) */
 	bool GetItemsByClass(const TSubclassOf<UXIUItem> ItemClass, TArray<UXIUItem*>& FoundItems);
 	/** @return Count actually consumed */
 	int32 ConsumeItemByDefinition(const UXIUItemDefinition* ItemDefinition, const int32 Count);
+	/** Appends definition and count of every item (stored pages included), as a read only copy that can be used
+	 * off the game thread */
+	void GatherItemCounts(TArray<TPair<const UXIUItemDefinition*, int32>>& OutItems) const;
+	/** Consumes every ingredient Multiplier times, or nothing at all. Availability is checked and removals are
+	 * planned in a single pass over the slots, then committed in one change batch
+	 * @return Multiplier if consumed, otherwise the max multiplier that could have been consumed (nothing is consumed) */
+	int32 ConsumeRecipe(TConstArrayView<FXIUItemDefault> Ingredients, const int32 Multiplier);
+	/** Does not create nor modify anything. Stops scanning as soon as Desired is reached.
+	 * Stored pages are answered from their summary, which keeps their free slots by filter and their stack space
+	 * @return how many items of this definition AddItemDefault would insert, clamped to Desired */
+	int32 GetInsertableCount(const UXIUItemDefinition* ItemDefinition, const int32 Desired) const;
+	/** Same as above, but uses the filter and stacking rules of this item instance
+	 * @param Desired if negative, the count of the item is used */
+	int32 GetInsertableCount(UXIUItem* Item, const int32 Desired) const;
 	
 /*--------------------------------------------------------------------------------------------------------------------*/
 
@@ -252,12 +667,242 @@ public:
 	 * @param Slot: reference to modified slot
 	 * @param OldCount: old count of item in slot
 	 * @param NewCount: new count of item in slot
-	 * @param bRegisterItemChange: if true stops replicating old item and unbind delegate, and start replicating new item and bind delegate
+	 * @param bRegisterItemChange: if true stops replicating old item and clears its owner, and start replicating new item and sets its owner
 	 * @param OldItem: old item that was in slot
 	 */
 	void RegisterSlotChange(const FXIUInventorySlot& Slot, const int32 OldCount, const int32 NewCount, const bool bRegisterItemChange, UXIUItem* OldItem = nullptr);
+	/** Makes the items stop pointing to this list. Called when the object hosting the list is destroyed, since items
+	 * can outlive it (e.g. on client, until their own destruction replicates) */
+	void ClearItemOwners();
+private:
+	/** Server. Called before a slot or an item of this list changes (see UXIUInventoryComponent::WakeOwnerNetDormancy) */
+	void WakeNetDormancy() const;
+	/** Makes Item notify this list directly when its count changes or when it gets initialized (see UXIUItem::OwnerList) */
+	void SetItemOwner(UXIUItem* Item, const int32 SlotIndex);
+	/** Does nothing if Item already points to another slot or list (it moved there before leaving this slot) */
+	void ClearItemOwner(UXIUItem* Item, const int32 SlotIndex);
+	/** Called by an item of this list when its count changed. O(1), since the item knows its slot */
+	void OnItemCountChanged(UXIUItem* Item, const int32 OldCount);
+	/** Called by an item that was registered to this list before being initialized */
+	void OnItemInitialized(UXIUItem* Item);
 	
 /*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+	/* Occupancy tracking */
+
+public:
+	bool IsInventoryEmpty() const { return OccupiedSlotCount == 0; }
+	int32 GetOccupiedSlotCount() const { return OccupiedSlotCount; }
+	int32 GetTotalItemCount() const { return TotalItemCount; }
+	/** @return index of the first slot holding a non-empty item, or INDEX_NONE (amortized O(1)) */
+	int32 GetFirstOccupiedSlotIndex() const;
+	/** @return weight and volume of a single unit of this item (zero if it has no capacity fragment) */
+	static FXIUInventoryLoad GetUnitLoad(const UXIUItemDefinition* ItemDefinition);
+private:
+	/** Called by RegisterSlotChange (so both on server and client) to keep the counters below up to date */
+	void UpdateSlotTracking(const FXIUInventorySlot& Slot, const int32 NewCount);
+	void ResetSlotTracking();
+	/** Last count registered for each slot, indexed by slot index */
+	TArray<int32> TrackedSlotCounts;
+	/** Server. Last load registered for each slot, indexed by slot index (only allocated up to the last slot that
+	 * ever held an item with weight or volume) */
+	TArray<FXIUInventoryLoad> TrackedSlotLoads;
+	int32 OccupiedSlotCount = 0;
+	int32 TotalItemCount = 0;
+	/** no occupied slot has an index lower than this. Advanced lazily by GetFirstOccupiedSlotIndex */
+	mutable int32 FirstOccupiedSlotCursor = 0;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+	/* Change generations */
+
+public:
+	/** Increased every time a slot changes, on server and client (not replicated, so they do not match) */
+	uint32 GetGeneration() const { return Generation; }
+	/** @param OutSlots filled with the index of every slot that changed after Generation (including slots that were
+	 * removed, which are >= GetSize()). O(1) if nothing changed, otherwise O(slots)
+	 * @return current generation, to pass in the next call */
+	uint32 GetChangesSince(const uint32 SinceGeneration, TArray<int32>& OutSlots) const;
+private:
+	/** Called by RegisterSlotChange, so on both server and client */
+	void MarkSlotChanged(const int32 SlotIndex);
+	/** Marks the slots from NewSize to the current size, before they get removed */
+	void MarkRemovedSlotsChanged(const int32 NewSize);
+	uint32 Generation = 0;
+	/** Generation of the last change of each slot, indexed by slot index */
+	TArray<uint32> SlotGenerations;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+	/* Nested containers */
+
+public:
+	/** @return true if this list is the contents of a container item */
+	bool IsNested() const { return OwnerContainer != nullptr; }
+	UXIUContainerItem* GetOwnerContainer() const { return OwnerContainer; }
+	/** @return count of this item inside the containers held by this list (at any depth). O(1) */
+	int32 CountNestedItemsByDefinition(const UXIUItemDefinition* ItemDefinition) const;
+	const TMap<const UXIUItemDefinition*, int32>& GetNestedItemCounts() const { return NestedItemCounts; }
+private:
+	/** Called when something changed inside a container held by this list. Updates the nested counts, then
+	 * propagates to the container holding this list, or to the owner component load */
+	void ApplyNestedDelta(const UXIUItemDefinition* ItemDefinition, const int32 CountDelta, const FXIUInventoryLoad& LoadDelta);
+	/** Starts reporting the aggregates of a container that got in a slot of this list */
+	void AttachContainer(UXIUContainerItem* Container);
+	/** Stops reporting the aggregates of a container that left this list.
+	 * @param bKeepAggregates keeps the aggregates of the container in this list, for containers going in a stored page */
+	void DetachContainer(UXIUContainerItem* Container, const bool bKeepAggregates = false);
+	/** Set if this list is the contents of a container item (which owns the list) */
+	UXIUContainerItem* OwnerContainer = nullptr;
+	/** @return container owning this list, or the owner component (used to identify the list in traces) */
+	const UObject* GetTraceOwner() const;
+	/** Only used by nested lists, to report count changes by definition. Indexed by slot index */
+	TArray<const UXIUItemDefinition*> TrackedSlotDefinitions;
+	TMap<const UXIUItemDefinition*, int32> NestedItemCounts;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+	/* Snapshot */
+
+public:
+	/** Writes slot settings, item definitions, counts and per item data (UXIUItem::SerializeSnapshotData).
+	 * Stored pages are loaded back first, so this reads the disk when paged storage is used */
+	void SaveSnapshot(FArchive& Ar);
+	/** Replaces every slot with the content of the snapshot. Items are created and registered in bulk, without
+	 * broadcasting a change message per slot.
+	 * @return false if the snapshot is invalid, or the data of an item is (inventory is left untouched) */
+	bool LoadSnapshot(FArchive& Ar);
+private:
+	/** Applies settings and places the item of a slot, without broadcasting.
+	 * The item was made from the snapshot, together with its data, before anything changed (XIUInventorySnapshot::MakeItems)
+	 * @param bRecordInJournal: false when the slot is only loaded back (PageIn), since nothing changed */
+	void RestoreSlot(FXIUInventorySlot& Slot, const FXIUInventorySlotSettings& Settings, UXIUItem* NewItem, const bool bRecordInJournal = true);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+	/* Paged storage */
+
+public:
+	/** Server. Slots will live in pages of InSlotsPerPage slots, created on first write.
+	 * Must be called before InitInventory.
+	 * @param InPageStore: where cold pages are written. If null, pages are never stored */
+	void EnablePagedStorage(const int32 InSlotsPerPage, const TSharedPtr<FXIUInventoryPageStore>& InPageStore);
+	/** Client. Paging settings received from server */
+	void SetPagingInfo(const int32 InSlotsPerPage, const int32 InSlotCount);
+	bool IsPaged() const { return SlotsPerPage > 0; }
+	int32 GetSlotsPerPage() const { return SlotsPerPage; }
+	int32 GetPageIndex(const int32 SlotIndex) const { return SlotIndex / SlotsPerPage; }
+	/** Server. */
+	EXIUInventoryPageState GetPageState(const int32 PageIndex) const;
+	/** Server. Loads a stored page back. Blocks on disk, unless the page store still has the page in memory (see
+	 * FXIUInventoryPageStore::PrefetchPage). Every function loading pages ends up here: LoadItemAtSlot, the
+	 * mutations of slots in stored pages, AddItem and consume (for pages holding the same definition), SaveSnapshot
+	 * and moving the replication window
+	 * @return true if the page is now resident */
+	bool PageIn(const int32 PageIndex);
+	/** Server. Writes a resident page to the page store (in the background) and releases its slots and items.
+	 * Only pages outside the replication window can be paged out, since clients would lose their slots otherwise
+	 * @return true if the page is not resident anymore */
+	bool PageOut(const int32 PageIndex);
+	/** Server. Pages out every resident page not accessed in the last ColdTime seconds
+	 * @return number of pages paged out */
+	int32 PageOutColdPages(const double ColdTime);
+	void PageInAll();
+	/** @return count of this item in stored pages (already excluded from the resident slots) */
+	int32 CountStoredItemsByDefinition(const UXIUItemDefinition* ItemDefinition) const;
+	bool HasFreeSlotsOutsideResidentPages() const;
+	/** @return count of this item that stored and unallocated pages can receive, answered from the page summaries
+	 * (stored stacks are matched by definition) */
+	int64 GetInsertableCountOutsideResidentPages(const UXIUItemDefinition* ItemDefinition, const UClass* ItemClass, const int32 MaxCount) const;
+private:
+	/** Server. @return slot with this index, creating or loading its page if needed */
+	FXIUInventorySlot* FindOrMaterializeSlot(const int32 SlotIndex);
+	/** Server. @return slot with this index, loading its page if stored. nullptr if its page was never written */
+	FXIUInventorySlot* FindResidentSlot(const int32 SlotIndex);
+	void MaterializePage(const int32 PageIndex);
+	/** Makes resident the first page which might have a free slot
+	 * @return false if there is none */
+	bool MaterializePageWithFreeSlots();
+	void ResetPages(const int32 SlotCount);
+	void TouchPage(const int32 PageIndex);
+	void PageInDefinition(const UXIUItemDefinition* ItemDefinition);
+	/** Prefetches every stored page matching Predicate, then pages them in */
+	void PageInWhere(TFunctionRef<bool(const FXIUInventoryPage&)> Predicate);
+	/** @return true if some client might have the slots of this page (always, without windowed replication) */
+	bool IsPageReplicated(const int32 PageIndex) const;
+	
+	UPROPERTY(NotReplicated)
+	TArray<FXIUInventoryPage> Pages;
+	int32 SlotsPerPage = 0;
+	int32 PagedSlotCount = 0;
+	TSharedPtr<FXIUInventoryPageStore> PageStore;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+	/* Journal */
+
+public:
+	/** Server. Every slot change registered from now on is recorded in this journal (nullptr to stop recording) */
+	void SetJournal(const TSharedPtr<FXIUInventoryJournal>& InJournal) { Journal = InJournal; }
+	FXIUInventoryJournal* GetJournal() const { return Journal.Get(); }
+private:
+	TSharedPtr<FXIUInventoryJournal> Journal;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+	/* Memory */
+
+public:
+	/** @return bytes allocated by the slots and the bookkeeping of this list (items excluded) */
+	SIZE_T GetAllocatedSize() const;
+	/** Adds slots, items and delegate bindings of this list to the report (contents of containers included) */
+	void GatherMemoryReport(FXIUInventoryMemoryReport& Report) const;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+	/* Net stats */
+
+public:
+	static constexpr int32 ReplicatedBytesWindow = 60;
+	/** Server. Bytes of slot deltas written in the last Seconds (up to ReplicatedBytesWindow), summed over every
+	 * connection, contents of containers included. Items replicate as subobjects, so their own properties are not
+	 * included */
+	uint64 GetReplicatedBytes(const int32 Seconds) const;
+private:
+	void RecordReplicatedBytes(const uint64 Bytes);
+	/** Bytes written during each second, in a ring indexed by second */
+	uint64 ReplicatedBytes[ReplicatedBytesWindow] = {};
+	int64 ReplicatedBytesSeconds[ReplicatedBytesWindow] = {};
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+	/* Windowed replication */
+
+public:
+	/** Server. From now on only slots in the replication window (and their items) are replicated */
+	void EnableWindowedReplication();
+	bool IsWindowedReplication() const { return bWindowedReplication; }
+	/** Server. Sets the slots to replicate [FirstSlot, LastSlot), starts replicating the items that entered the
+	 * window, and stops replicating the ones that left it */
+	void SetReplicationWindow(const int32 FirstSlot, const int32 LastSlot);
+	bool ShouldReplicateSlot(const int32 SlotIndex) const { return !bWindowedReplication || (SlotIndex >= WindowFirstSlot && SlotIndex < WindowLastSlot); }
+private:
+	/** Registers the item as replicated object if its slot is in the replication window */
+	void RegisterSlotItem(const FXIUInventorySlot& Slot, UXIUItem* Item);
+	bool bWindowedReplication = false;
+	int32 WindowFirstSlot = 0;
+	int32 WindowLastSlot = 0;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
 	
 
 	
@@ -269,6 +914,24 @@ struct TStructOpsTypeTraits<FXIUInventoryList> : public TStructOpsTypeTraitsBase
 	enum { WithNetDeltaSerializer = true };
 };
 
+/** Opens a change batch on an inventory list for the duration of a scope */
+struct FXIUInventoryChangeBatchScope
+{
+	explicit FXIUInventoryChangeBatchScope(FXIUInventoryList& InList)
+		: List(InList)
+	{
+		List.BeginChangeBatch();
+	}
+
+	~FXIUInventoryChangeBatchScope()
+	{
+		List.EndChangeBatch();
+	}
+
+private:
+	FXIUInventoryList& List;
+};
+
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE(FXIUInventoryInitializedSignature);
 
@@ -290,6 +953,8 @@ class XYLOINVENTORYUTIL_API UXIUInventoryComponent : public UXROUObjectReplicato
 {
 	GENERATED_BODY()
 
+	friend FXIUInventoryList;
+
 public:
 	UXIUInventoryComponent(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
 
@@ -302,9 +967,13 @@ public:
 
 protected:
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 public:
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	virtual void BeginDestroy() override;
+	/** Reports GetMemoryReport().GetTotalBytes() (used by memreport and obj list) */
+	virtual void GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize) override;
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -324,7 +993,22 @@ protected:
 	void OnRep_InventoryInitialized();
 	UFUNCTION(BlueprintImplementableEvent, Category= "Inventory", DisplayName = "OnInventoryInitialized")
 	void BP_OnInventoryInitialized();
+	/** Clients broadcast InventoryInitializedDelegate again when a snapshot got restored */
+	UFUNCTION()
+	void OnRep_RestoreCount();
+public:
+	/** @return true while the slots of a restored snapshot are applied. Their change messages are not broadcast, since
+	 * listeners get InventoryInitializedDelegate once the restore is done */
+	bool IsRestoringSnapshot() const { return bInitializedBroadcast && RestoreCount != AppliedRestoreCount; }
 private:
+	/** Incremented by LoadSnapshot. Declared before bInventoryInitialized, so that its notify comes first when both
+	 * replicate together */
+	UPROPERTY(ReplicatedUsing = OnRep_RestoreCount)
+	int32 RestoreCount = 0;
+	/** RestoreCount whose slots have all been applied */
+	int32 AppliedRestoreCount = 0;
+	/** Set once InventoryInitializedDelegate got broadcast. Slots replicated before that are the initial ones */
+	bool bInitializedBroadcast = false;
 	UPROPERTY(ReplicatedUsing = OnRep_InventoryInitialized)
 	bool bInventoryInitialized = false;
 
@@ -336,10 +1020,11 @@ public:
 	 * CLIENT SIDE: using the three functions provided by FFastArraySerializer to track replication changes i call
 	 *				Inventory.RegisterSlotChange(...).
 	 *				note that as OldItem we use Slot.GetItem() in Remove and Slot.LastObservedItem.Get() in Change, this is
-	 *				because we always want to unbind, even if count is zero (and GetItemSafe would not return empty items)
-	 * ITEM COUNT: to trigger on item count change, we bind OnItemCountChanged to Item->ItemCountChangedDelegate (Happens in
-	 *			   Bind and Unbind functions mentioned above). The bound function is responsible for calling
-	 *			   Inventory.RegisterSlotChange(...).
+	 *				because we always want to clear the item owner, even if count is zero (and GetItemSafe would not return
+	 *				empty items)
+	 * ITEM COUNT: RegisterSlotChange makes the item point to its list and slot (UXIUItem::OwnerList), and the item calls
+	 *			   Inventory.OnItemCountChanged(...) directly, which is responsible for calling
+	 *			   Inventory.RegisterSlotChange(...). Item delegates are only used by external listeners.
 	 *			   Item count is set to zero on client inside OnDestroyedFromReplication, and on server in DestroyObject
 	 */
 	UPROPERTY(BlueprintAssignable, Category = "Inventory")
@@ -348,24 +1033,6 @@ public:
 protected:
 	UFUNCTION(BlueprintImplementableEvent, Category= "Inventory", DisplayName = "OnInventoryChanged")
 	void BP_OnInventoryChanged();
-
-public:
-	void BindItemCountChangedDelegate(UXIUItem* InItem);
-	void UnBindItemCountChangedDelegate(UXIUItem* InItem);
-private:
-	/** Calls Inventory.BroadcastChangeMessage
-	 * Manages the unbinding from item count change delegate in case the item count reaches zero */
-	UFUNCTION()
-	void OnItemCountChanged(const FXIUItemCountChangeMessage& Change);
-
-private:
-	/** Calls Inventory.BroadcastChangeMessage */
-	UFUNCTION()
-	void OnItemInitialized(UXIUItem* InItem);
-public:
-	void BindItemInitializedDelegate(UXIUItem* InItem);
-	void UnBindItemInitializedDelegate(UXIUItem* InItem);
-	
 	
 /*--------------------------------------------------------------------------------------------------------------------*/
 
@@ -390,16 +1057,181 @@ private:
 	int32 InventorySize;
 	UPROPERTY(EditAnywhere, Category = "Inventory")
 	bool bManualInitialization;
+	/** Distinct settings of the slots of Inventory (slots replicate an index in it). Append only */
+	UPROPERTY(ReplicatedUsing = OnRep_SlotSettingsPalette)
+	TArray<FXIUInventorySlotSettings> SlotSettingsPalette;
+	UFUNCTION()
+	void OnRep_SlotSettingsPalette();
+
+public:
+	/** @return number of slots (including slots of pages which are not resident) */
+	UFUNCTION(BlueprintPure, Category= "Inventory")
+	int32 GetInventorySize() const;
+protected:
+	void UpdatePagingInfo();
+	UFUNCTION()
+	void OnRep_PagingInfo();
+	void PageOutColdPages();
+private:
+	/** Store slots in pages created on first write, for very large inventories */
+	UPROPERTY(EditAnywhere, Category = "Inventory|Paging")
+	bool bPagedStorage;
+	UPROPERTY(EditAnywhere, Category = "Inventory|Paging", meta = (EditCondition = "bPagedStorage", ClampMin = 1))
+	int32 SlotsPerPage;
+	/** Seconds without access after which a page is written to disk and its items released. Negative keeps every
+	 * page in memory. Needs bWindowedReplication: only pages outside the replication window are written to disk */
+	UPROPERTY(EditAnywhere, Category = "Inventory|Paging", meta = (EditCondition = "bPagedStorage"))
+	float ColdPageTime;
+	UPROPERTY(ReplicatedUsing = OnRep_PagingInfo)
+	FXIUInventoryPagingInfo PagingInfo;
+	FTimerHandle ColdPageTimerHandle;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+	/* Net Dormancy */
+
+public:
+	/** Server. Called by Inventory before its slots or items change, so the change is not lost on a dormant channel.
+	 * Wakes the UXIUNetDormancyComponent of the owner if it has one, otherwise only flushes the owner */
+	void WakeOwnerNetDormancy();
+private:
+	UPROPERTY(Transient)
+	TObjectPtr<UXIUNetDormancyComponent> OwnerNetDormancy;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+	/* Windowed replication */
+
+public:
+	/** Declare which slots the client is looking at. Only those slots (and their items) get replicated, together
+	 * with the adjacent pages, which are prefetched for scrolling. Other pages only replicate their summary.
+	 * Clients can only call this on inventories whose owner they own (the server RPC needs the owning connection) */
+	UFUNCTION(BlueprintCallable, Category= "Inventory|Replication")
+	void SetVisibleSlotRange(const int32 FirstSlot, const int32 NumSlots);
+	UFUNCTION(BlueprintCallable, Category= "Inventory|Replication")
+	void SetVisiblePage(const int32 PageIndex);
+	UFUNCTION(Server, Reliable, Category= "Inventory|Replication")
+	void ServerSetVisibleSlotRangeRPC(const int32 FirstSlot, const int32 NumSlots);
+	/** Slots per page used by windowed replication (SlotsPerPage if storage is paged) */
+	UFUNCTION(BlueprintPure, Category= "Inventory|Replication")
+	int32 GetReplicationPageSize() const;
+	UFUNCTION(BlueprintPure, Category= "Inventory|Replication")
+	FXIUInventoryPageSummary GetPageSummary(const int32 PageIndex) const;
+	const TArray<FXIUInventoryPageSummary>& GetPageSummaries() const { return PageSummaries; }
+	/** Called by the inventory list when windowed replication is enabled */
+	void UpdatePageSummary(const int32 SlotIndex, const int32 OccupiedDelta, const int32 CountDelta);
+	void ResetPageSummaries();
+private:
+	void ApplyVisibleSlotRange(const int32 FirstSlot, const int32 NumSlots);
+	/** Only replicate the visible slots to clients (use with large inventories, like banks). There is one window per
+	 * inventory, set by its owner, so the slots are only replicated to the owning connection: other clients only get
+	 * the page summaries. Unowned inventories (like a shared AXIUInventoryActor) cannot be windowed */
+	UPROPERTY(EditAnywhere, Category = "Inventory|Replication")
+	bool bWindowedReplication;
+	/** Page size used by windowed replication when storage is not paged */
+	UPROPERTY(EditAnywhere, Category = "Inventory|Replication", meta = (EditCondition = "bWindowedReplication", ClampMin = 1))
+	int32 ReplicationPageSize;
+	UPROPERTY(Replicated)
+	TArray<FXIUInventoryPageSummary> PageSummaries;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+	/* Capacity */
+
+public:
+	UFUNCTION(BlueprintPure, Category= "Inventory|Capacity")
+	float GetCurrentWeight() const { return Capacity.CurrentLoad.GetWeight(); }
+	UFUNCTION(BlueprintPure, Category= "Inventory|Capacity")
+	float GetCurrentVolume() const { return Capacity.CurrentLoad.GetVolume(); }
+	UFUNCTION(BlueprintPure, Category= "Inventory|Capacity")
+	float GetMaxWeight() const { return Capacity.MaxLoad.GetWeight(); }
+	UFUNCTION(BlueprintPure, Category= "Inventory|Capacity")
+	float GetMaxVolume() const { return Capacity.MaxLoad.GetVolume(); }
+	/** Server. Items already in the inventory are kept, even if they exceed the new limits (0 means no limit) */
+	UFUNCTION(BlueprintCallable, Category= "Inventory|Capacity")
+	void SetCapacityLimits(const float NewMaxWeight, const float NewMaxVolume);
+	const FXIUInventoryLoad& GetCurrentLoad() const { return Capacity.CurrentLoad; }
+	/** @param FreedLoad: load that will be removed from the inventory by the same operation (e.g. replaced item)
+	 * @return how much of Count fits in the remaining weight and volume */
+	int32 GetCountWithinCapacity(const FXIUInventoryLoad& UnitLoad, const int32 Count, const FXIUInventoryLoad& FreedLoad = FXIUInventoryLoad()) const;
+	/** Called by the inventory list on server */
+	void UpdateLoad(const FXIUInventoryLoad& LoadDelta);
+	void ResetLoad();
+private:
+	/** Initial max weight of all items (0 means no limit). Weight of items comes from UXIUCapacityFragment */
+	UPROPERTY(EditAnywhere, Category = "Inventory|Capacity", meta = (ClampMin = 0))
+	float MaxWeight;
+	/** Initial max volume of all items (0 means no limit). Volume of items comes from UXIUCapacityFragment */
+	UPROPERTY(EditAnywhere, Category = "Inventory|Capacity", meta = (ClampMin = 0))
+	float MaxVolume;
+	/** Maintained by the server from slot changes and SetCapacityLimits, so clients never need to recompute it and
+	 * always check against the current limits */
+	UPROPERTY(Replicated)
+	FXIUInventoryCapacity Capacity;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+	/* Journal */
+
+public:
+	/** Server. Takes a snapshot of the inventory (<Path>.snapshot), then records every slot change in the journal
+	 * file, written by a background thread
+	 * @param Path: if empty, a new file in Saved/XyloInventoryUtil/Journal
+	 * @return true if the journal started */
+	UFUNCTION(BlueprintCallable, Category= "Inventory|Journal")
+	bool StartJournal(const FString& Path);
+	UFUNCTION(BlueprintCallable, Category= "Inventory|Journal")
+	void StopJournal();
+	/** Server. Stops the journal, then rebuilds the inventory from a journal and its snapshot */
+	UFUNCTION(BlueprintCallable, Category= "Inventory|Journal")
+	bool ReplayJournal(const FString& Path);
+	FXIUInventoryJournal* GetJournal() const { return Journal.Get(); }
+private:
+	/** Record every slot change in a journal file, from BeginPlay (for audits, see StartJournal) */
+	UPROPERTY(EditAnywhere, Category = "Inventory|Journal")
+	bool bJournal;
+	/** Records kept in memory before the writer thread gets to them. If full, records are dropped */
+	UPROPERTY(EditAnywhere, Category = "Inventory|Journal", meta = (EditCondition = "bJournal", ClampMin = 64))
+	int32 JournalCapacity;
+	TSharedPtr<FXIUInventoryJournal> Journal;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+	/* Diagnostics */
+
+public:
+	/** Memory used by slots, items and delegate bindings of this inventory (contents of containers included) */
+	UFUNCTION(BlueprintPure, Category= "Inventory|Diagnostics")
+	FXIUInventoryMemoryReport GetMemoryReport() const;
+	/** Server. see FXIUInventoryList::GetReplicatedBytes */
+	uint64 GetReplicatedBytes(const int32 Seconds) const;
+	/** Writes every slot (contents of containers included) and the memory report. Used by xiu.DumpInventory */
+	void DumpInventory(FOutputDevice& Ar) const;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
 
 public:
 	UFUNCTION(BlueprintCallable, Category= "Inventory")
 	void InputAddDefaultItems();
 	UFUNCTION(Server, Reliable, Category= "Inventory")
 	void ServerAddDefaultItemsRPC();
+	/** Adds DefaultItems, then rolls LootTable (if set) */
 	void AddDefaultItems();
+	/** Evaluates the table in a task, then adds the result on game thread in a single bulk add
+	 * @param Seed: same seed, same loot */
+	UFUNCTION(BlueprintCallable, Category= "Inventory")
+	void AddLootTableItems(UXIULootTable* InLootTable, const int32 Seed);
 private:
 	UPROPERTY(EditAnywhere, Category= "Inventory")
 	TArray<FXIUItemDefault> DefaultItems;
+	UPROPERTY(EditAnywhere, Category= "Inventory")
+	TObjectPtr<UXIULootTable> LootTable;
+	/** Seed used to roll LootTable. 0 means a random seed */
+	UPROPERTY(EditAnywhere, Category= "Inventory")
+	int32 LootSeed = 0;
 	
 public:
 	UFUNCTION(BlueprintCallable, Category= "Inventory")
@@ -407,6 +1239,11 @@ public:
 	
 	UFUNCTION(BlueprintCallable, Category= "Inventory")
 	void AddItemDefault(const FXIUItemDefault ItemDefault);
+	/** Adds all the items under one change batch
+	 * @return Count of items which were not added */
+	int32 AddItemDefaults(TConstArrayView<FXIUItemDefault> ItemDefaults);
+	UFUNCTION(BlueprintCallable, Category= "Inventory", DisplayName = "Add Item Defaults")
+	int32 K2_AddItemDefaults(const TArray<FXIUItemDefault>& ItemDefaults);
 
 	/** duplicates this item and adds as much count as possible from this duplicate.
 	 * The function already modifies the count of the Item passed as parameter to account for
@@ -431,6 +1268,7 @@ public:
 	 * @param SlotIndex: index of the slot to drop the item from
 	 * @param Count: count to drop of that item (if -1 drops all)
 	 * @param bFinishSpawning: if true, spawns the dropped item actor
+	 * Dropping a whole stack in a AXIUItemActor moves the item itself to the actor, without copying it
 	 * @return pointer to the item actor. FinishSpawning must be called
 	 */
 	UFUNCTION(BlueprintCallable, Category= "Inventory")
@@ -439,20 +1277,71 @@ public:
 	/** @return number of items actually consumed */
 	UFUNCTION(BlueprintCallable, Category= "Inventory")
 	int32 ConsumeItemsByDefinition(UXIUItemDefinition* ItemDefinition, const int32 Count);
+
+	/** Consumes all the ingredients Multiplier times, or nothing if any of them is missing.
+	 * @return Multiplier if consumed, otherwise the max craftable multiplier (and nothing got consumed) */
+	int32 TryConsumeRecipe(TConstArrayView<FXIUItemDefault> Ingredients, const int32 Multiplier = 1);
+	UFUNCTION(BlueprintCallable, Category= "Inventory", DisplayName = "Try Consume Recipe")
+	int32 K2_TryConsumeRecipe(const TArray<FXIUItemDefault>& Ingredients, const int32 Multiplier = 1);
+
+	/** Applies the commands in order under one change batch, then calls their OnCompleted with the results (game
+	 * thread). Usually called by UXIUInventoryWorldSubsystem, which queues commands coming from any thread */
+	void ExecuteCommands(TArrayView<FXIUInventoryCommand> Commands);
+private:
+	/** @return count added, consumed or moved */
+	int32 ExecuteCommand(const FXIUInventoryCommand& Command);
+public:
 	
 	/** Gets first item in the inventory (not necessarily first slot)
-	 * (Already checks IsEmpty on items) */
+	 * (Already checks IsEmpty on items). nullptr if its page is stored on disk */
 	UFUNCTION(BlueprintCallable, Category= "Inventory")
 	UXIUItem* GetFirstItem();
 
+	/** @return true if no slot holds a non-empty item (O(1)) */
+	UFUNCTION(BlueprintPure, Category= "Inventory")
+	bool IsInventoryEmpty() const;
+	/** @return number of slots holding a non-empty item (O(1)) */
+	UFUNCTION(BlueprintPure, Category= "Inventory")
+	int32 GetOccupiedSlotCount() const;
+	/** @return sum of the counts of all items in the inventory (O(1)) */
+	UFUNCTION(BlueprintPure, Category= "Inventory")
+	int32 GetTotalItemCount() const;
+
+	/** see FXIUInventoryList::GetChangesSince. Meant to be polled (e.g. once per frame by a widget) to only refresh
+	 * the slots that changed since the last sync */
+	uint32 GetChangesSince(const uint32 Generation, TArray<int32>& OutSlots) const;
+	/** Generations are int64 in blueprint, which has no uint32, so they compare exactly like the native ones */
+	UFUNCTION(BlueprintCallable, Category= "Inventory", DisplayName = "Get Changes Since")
+	int64 K2_GetChangesSince(const int64 Generation, TArray<int32>& OutSlots) const;
+	UFUNCTION(BlueprintPure, Category= "Inventory")
+	int64 GetInventoryGeneration() const;
+
 	UFUNCTION(BlueprintCallable, Category= "Inventory")
 	int32 CountItemsByDefinition(UXIUItemDefinition* ItemDefinition);
+	/** see FXIUInventoryList::GatherItemCounts */
+	void GatherItemCounts(TArray<TPair<const UXIUItemDefinition*, int32>>& OutItems) const;
 
 	/** Check if you can insert any count of this item in inventory */
 	bool CanInsertItem(UXIUItem* Item) const;
-
+	/** Cheap enough to be called every frame (no item gets created)
+	 * @return how many items of this definition can be inserted, up to Desired */
+	UFUNCTION(BlueprintPure, Category= "Inventory")
+	int32 GetInsertableCount(const UXIUItemDefinition* ItemDefinition, const int32 Desired) const;
+	/** @param Desired if negative, the count of the item is used
+	 * @return how many of this item can be inserted, up to Desired */
+	UFUNCTION(BlueprintPure, Category= "Inventory")
+	int32 GetInsertableCountForItem(UXIUItem* Item, const int32 Desired = -1) const;
+
+	/** nullptr for slots of pages stored on disk (see FXIUInventoryList::GetItemAtSlot) */
 	UFUNCTION(BlueprintCallable, Category= "Inventory")
 	UXIUItem* GetItemAtSlot(const int32 SlotIndex);
+
+	/** Serializes the whole inventory in a compact versioned binary format */
+	bool SaveSnapshot(TArray<uint8>& OutData);
+	/** Server only. Restores an inventory saved with SaveSnapshot, replacing all slots and items, then broadcasts
+	 * InventoryInitializedDelegate once, on server and clients, instead of a change message per slot
+	 * @return true if the snapshot was valid and got applied */
+	bool LoadSnapshot(TConstArrayView<uint8> Data);
 	
 	
 };
@@ -0,0 +1,120 @@
+// Copyright XyloIsCoding 2024
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Queue.h"
+#include "HAL/Runnable.h"
+#include "UObject/ObjectKey.h"
+#include <atomic>
+
+class UXIUInventoryComponent;
+class UXIUItemDefinition;
+
+
+enum class EXIUJournalOp : uint8
+{
+	/** Count of the item in the slot changed */
+	Count,
+	/** Slot got a different item (or got emptied, if Definition is 0) */
+	Item
+};
+
+/** Fixed size record of a single slot change. Definition ids are only valid inside the journal that wrote them */
+struct FXIUJournalRecord
+{
+	uint64 Frame = 0;
+	uint32 Definition = 0;
+	/** Journal id of the inventory the items came from (0 if unknown or created from nothing) */
+	uint32 Source = 0;
+	int32 Slot = INDEX_NONE;
+	int32 Delta = 0;
+	int32 NewCount = 0;
+	EXIUJournalOp Op = EXIUJournalOp::Count;
+
+	friend FArchive& operator<<(FArchive& Ar, FXIUJournalRecord& Record);
+};
+
+/**
+ * Optional operation journal of an inventory (server only).
+ * Slot changes are pushed by the game thread in a fixed size single producer single consumer lock-free ring buffer,
+ * and written to disk by a writer thread. If the writer falls behind, records are dropped (and counted) rather than
+ * stalling the game thread. The journal file then contains a marker, and cannot be replayed.
+ * The journal starts with a snapshot of the inventory (<Path>.snapshot), so Replay can rebuild the inventory state.
+ */
+class XYLOINVENTORYUTIL_API FXIUInventoryJournal : public FRunnable
+{
+public:
+	/** @param Capacity: number of records in the ring buffer (rounded up to a power of two) */
+	FXIUInventoryJournal(const FString& InPath, const uint32 Capacity = 4096);
+	virtual ~FXIUInventoryJournal() override;
+
+	FXIUInventoryJournal(const FXIUInventoryJournal&) = delete;
+	FXIUInventoryJournal& operator=(const FXIUInventoryJournal&) = delete;
+
+	/** @return false if the journal file could not be created */
+	bool Start();
+	/** Writes everything that is left, then stops the writer thread */
+	void Shutdown();
+
+	/** Game thread */
+	void Record(const EXIUJournalOp Op, const int32 Slot, const UXIUItemDefinition* ItemDefinition, const int32 Delta, const int32 NewCount);
+
+	const FString& GetPath() const { return Path; }
+	FString GetSnapshotPath() const { return Path + TEXT(".snapshot"); }
+	uint64 GetDroppedCount() const { return DroppedCount.load(std::memory_order_relaxed); }
+
+	/** Game thread. Computed once per object
+	 * @return stable id of an inventory (or of any other outer items come from), used as Source of the records */
+	uint32 GetSourceId(const UObject* Source);
+	/** Restores the snapshot, then applies every record of the journal in order (server only)
+	 * @return false if the snapshot or the journal is invalid, or if the journal dropped records */
+	static bool Replay(UXIUInventoryComponent* Inventory, TConstArrayView<uint8> Snapshot, TConstArrayView<uint8> Journal);
+	/** Loads <JournalPath>.snapshot and JournalPath, then calls Replay */
+	static bool ReplayFromFile(UXIUInventoryComponent* Inventory, const FString& JournalPath);
+
+	/** Sets the source of the records pushed during its lifetime (game thread) */
+	struct FSourceScope
+	{
+		FSourceScope(FXIUInventoryJournal* InJournal, const UObject* Source);
+		~FSourceScope();
+	private:
+		FXIUInventoryJournal* Journal;
+		uint32 PreviousSource;
+	};
+
+	/*
+	 * FRunnable Interface
+	 */
+
+public:
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+private:
+	/** Writer thread. Writes pending definitions and records */
+	void Flush();
+
+	FString Path;
+	TArray<FXIUJournalRecord> Ring;
+	uint64 RingMask;
+	std::atomic<uint64> WriteIndex{0};
+	std::atomic<uint64> ReadIndex{0};
+	std::atomic<uint64> DroppedCount{0};
+
+	/** Game thread only */
+	TMap<const UXIUItemDefinition*, uint32> DefinitionIds;
+	uint32 CurrentSource = 0;
+	TMap<TObjectKey<UObject>, uint32> SourceIds;
+	/** Definitions are written before the records using them (ids start at 1) */
+	TQueue<TPair<uint32, FString>, EQueueMode::Spsc> PendingDefinitions;
+
+	/** Writer thread only */
+	TUniquePtr<FArchive> Writer;
+	TArray<FXIUJournalRecord> WriteBuffer;
+	uint64 WrittenDroppedCount = 0;
+
+	FRunnableThread* Thread = nullptr;
+	FEvent* WakeUpEvent = nullptr;
+	std::atomic<bool> bStopping{false};
+};
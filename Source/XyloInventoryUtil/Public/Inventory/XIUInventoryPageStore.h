@@ -0,0 +1,63 @@
+// Copyright XyloIsCoding 2024
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+#include <atomic>
+
+/**
+ * Local file backed storage for the cold pages of a paged FXIUInventoryList.
+ * Every page is a file in a directory owned by this store, which gets deleted together with the store.
+ * Disk access happens on the thread pool. Operations on the same page run in the order they were issued, and a page
+ * being written (or prefetched) is kept in memory, so the only call that can block the game thread on disk is ReadPage
+ * for a page which was not prefetched. Every function must be called from the game thread.
+ */
+class XYLOINVENTORYUTIL_API FXIUInventoryPageStore
+{
+public:
+	FXIUInventoryPageStore();
+	/** Waits for pending disk operations, then deletes the directory */
+	~FXIUInventoryPageStore();
+
+	FXIUInventoryPageStore(const FXIUInventoryPageStore&) = delete;
+	FXIUInventoryPageStore& operator=(const FXIUInventoryPageStore&) = delete;
+
+public:
+	/** Writes the page in the background. Data stays in memory until it is on disk (or forever, if the write fails) */
+	void WritePage(const int32 PageIndex, TArray<uint8>&& Data);
+	/** Starts reading the page in the background, so that ReadPage does not have to wait on disk */
+	void PrefetchPage(const int32 PageIndex);
+	/** @return true if ReadPage can be answered from memory */
+	bool IsPageInMemory(const int32 PageIndex) const;
+	/** Answers from memory if the page is being written or was prefetched, otherwise reads the file, blocking */
+	bool ReadPage(const int32 PageIndex, TArray<uint8>& OutData);
+	void RemovePage(const int32 PageIndex);
+	/** Frees the memory of pages which are now on disk. Should be called regularly */
+	void ReleaseWrittenPages();
+
+	const FString& GetDirectory() const { return Directory; }
+
+private:
+	struct FPendingPage
+	{
+		TArray<uint8> Data;
+		bool bWrite = false;
+		/** set by the disk operation before bDone */
+		bool bSucceeded = false;
+		std::atomic<bool> bDone{false};
+		bool bFailureReported = false;
+	};
+	using FPendingPageRef = TSharedRef<FPendingPage, ESPMode::ThreadSafe>;
+
+	/** Runs Operation on the thread pool, after the previous operation on the same page */
+	void Launch(const int32 PageIndex, TUniqueFunction<void()>&& Operation);
+	void WaitForPage(const int32 PageIndex);
+	FString GetPagePath(const int32 PageIndex) const;
+
+	FString Directory;
+	/** pages being written or prefetched, and pages whose write failed */
+	TMap<int32, FPendingPageRef> PendingPages;
+	/** last disk operation issued for each page */
+	TMap<int32, TFuture<void>> LastOperations;
+};
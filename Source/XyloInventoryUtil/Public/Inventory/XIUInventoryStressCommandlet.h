@@ -0,0 +1,31 @@
+// Copyright XyloIsCoding 2024
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "XIUInventoryStressCommandlet.generated.h"
+
+/**
+ * Headless load test of the inventory. Spawns inventories and pickups in a game world, then runs a seeded random mix
+ * of add, consume, transfer, drop and pickup operations for a fixed time, checking invariants along the way (no
+ * negative counts, no item in two places, counts conserved, O(1) counters matching the slots).
+ * Op throughput, op latency percentiles, peak UObject count and GC time are written as CSV.
+ *
+ * -run=XIUInventoryStress [-Seed=1] [-Inventories=100] [-Slots=32] [-Pickups=200] [-Duration=30] [-CheckInterval=1]
+ *		[-GCInterval=5] [-Definitions=/Game/Items/A.A,/Game/Items/B.B] [-ItemClass=/Script/Module.Class]
+ *		[-NumDefinitions=8] [-Csv=Path]
+ * Without -Definitions, transient definitions of ItemClass (or of the first concrete item class found) are used, with
+ * a drop fragment spawning AXIUItemActor.
+ * Returns 0 if no invariant got violated.
+ */
+UCLASS()
+class XYLOINVENTORYUTIL_API UXIUInventoryStressCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UXIUInventoryStressCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,100 @@
+// Copyright XyloIsCoding 2024
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "Trace/Trace.h"
+
+#if UE_TRACE_ENABLED && !UE_BUILD_SHIPPING
+#define XIU_INVENTORY_TRACE_ENABLED 1
+#else
+#define XIU_INVENTORY_TRACE_ENABLED 0
+#endif
+
+class UXIUItemDefinition;
+
+
+/** Inventory operation a slot change happened in */
+enum class EXIUInventoryTraceOp : uint8
+{
+	None,
+	Init,
+	Add,
+	Set,
+	Remove,
+	Consume,
+	Command,
+	Drop,
+	Snapshot,
+	Page,
+	Replication
+};
+
+/** FastArray callbacks (client), and delta writes (server) */
+enum class EXIUInventoryTraceReplication : uint8
+{
+	PreRemove,
+	PostAdd,
+	PostChange,
+	Write
+};
+
+#if XIU_INVENTORY_TRACE_ENABLED
+
+UE_TRACE_CHANNEL_EXTERN(XIUInventoryChannel, XYLOINVENTORYUTIL_API);
+
+/**
+ * Structured inventory events on the XIUInventoryChannel trace channel (-trace=XIUInventory, or Trace.Enable
+ * XIUInventory at runtime).
+ * Operations are also CPU scopes on the same channel, so they show up in the Timing view of Insights, next to frames
+ * and net traffic. Slot changes and replication callbacks are XIUInventory.SlotChange and XIUInventory.Replication
+ * events; inventories and item definitions are referenced by id, named once by an XIUInventory.ObjectName event.
+ * Nothing is evaluated unless the channel is enabled, and everything compiles out in shipping builds.
+ */
+struct XYLOINVENTORYUTIL_API FXIUInventoryTrace
+{
+	/** Game thread */
+	static void OutputSlotChange(const UObject* Inventory, const int32 Slot, const UXIUItemDefinition* ItemDefinition, const int32 Delta, const int32 NewCount, const bool bItemChanged);
+	static void OutputReplication(const UObject* Inventory, const EXIUInventoryTraceReplication Kind, const int32 NumSlots, const uint32 Bytes);
+
+	/** Sets the operation of the slot changes traced during its lifetime */
+	struct FOpScope
+	{
+		explicit FOpScope(const EXIUInventoryTraceOp Op)
+			: PreviousOp(CurrentOp)
+		{
+			CurrentOp = Op;
+		}
+		~FOpScope()
+		{
+			CurrentOp = PreviousOp;
+		}
+	private:
+		EXIUInventoryTraceOp PreviousOp;
+	};
+
+private:
+	/** @return id of the object, after naming it in the trace if it is the first time it is seen */
+	static uint64 GetObjectId(const UObject* Object);
+	static EXIUInventoryTraceOp CurrentOp;
+};
+
+/** CPU scope of an inventory operation, whose slot changes are traced with that operation */
+#define XIU_INVENTORY_TRACE_OP(Op) \
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL_STR("XIUInventory::" #Op, XIUInventoryChannel); \
+	FXIUInventoryTrace::FOpScope PREPROCESSOR_JOIN(XIUInventoryTraceOpScope, __LINE__)(EXIUInventoryTraceOp::Op);
+
+#define XIU_INVENTORY_TRACE_SLOT_CHANGE(Inventory, Slot, ItemDefinition, Delta, NewCount, bItemChanged) \
+	do { if (UE_TRACE_CHANNELEXPR_IS_ENABLED(XIUInventoryChannel)) FXIUInventoryTrace::OutputSlotChange(Inventory, Slot, ItemDefinition, Delta, NewCount, bItemChanged); } while (0)
+
+#define XIU_INVENTORY_TRACE_REPLICATION(Inventory, Kind, NumSlots, Bytes) \
+	do { if (UE_TRACE_CHANNELEXPR_IS_ENABLED(XIUInventoryChannel)) FXIUInventoryTrace::OutputReplication(Inventory, EXIUInventoryTraceReplication::Kind, NumSlots, Bytes); } while (0)
+
+#else
+
+#define XIU_INVENTORY_TRACE_OP(Op)
+#define XIU_INVENTORY_TRACE_SLOT_CHANGE(Inventory, Slot, ItemDefinition, Delta, NewCount, bItemChanged) do { } while (0)
+#define XIU_INVENTORY_TRACE_REPLICATION(Inventory, Kind, NumSlots, Bytes) do { } while (0)
+
+#endif
@@ -0,0 +1,133 @@
+// Copyright XyloIsCoding 2024
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+#include "Containers/Queue.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "XIUInventoryWorldSubsystem.generated.h"
+
+class UXIUInventoryComponent;
+class UXIUItemDefinition;
+
+
+enum class EXIUInventoryCommandType : uint8
+{
+	/** Adds Count of ItemDefinition. Result is the count added */
+	Add,
+	/** Consumes Count of ItemDefinition. Result is the count consumed */
+	Consume,
+	/** Moves Count (or the whole stack if <= 0) of the item at SlotIndex to TargetInventory. Result is the count moved */
+	Move
+};
+
+/** Inventory mutation that can be built and queued from any thread, see UXIUInventoryWorldSubsystem::EnqueueCommand */
+struct XYLOINVENTORYUTIL_API FXIUInventoryCommand
+{
+	static FXIUInventoryCommand MakeAdd(const TWeakObjectPtr<UXIUInventoryComponent>& Inventory, UXIUItemDefinition* ItemDefinition, const int32 Count);
+	static FXIUInventoryCommand MakeConsume(const TWeakObjectPtr<UXIUInventoryComponent>& Inventory, UXIUItemDefinition* ItemDefinition, const int32 Count);
+	static FXIUInventoryCommand MakeMove(const TWeakObjectPtr<UXIUInventoryComponent>& Inventory, const int32 SlotIndex, const TWeakObjectPtr<UXIUInventoryComponent>& TargetInventory, const int32 Count = -1);
+	
+	TWeakObjectPtr<UXIUInventoryComponent> Inventory;
+	TWeakObjectPtr<UXIUInventoryComponent> TargetInventory;
+	UXIUItemDefinition* ItemDefinition = nullptr;
+	int32 Count = 0;
+	int32 SlotIndex = INDEX_NONE;
+	EXIUInventoryCommandType Type = EXIUInventoryCommandType::Add;
+	/** Called on game thread once the batch of the inventory got applied (0 if the inventory is gone or not owned by
+	 * the server) */
+	TFunction<void(int32)> OnCompleted;
+};
+
+
+/** Batch query over every inventory registered in the world */
+struct XYLOINVENTORYUTIL_API FXIUInventoryQuery
+{
+	/** Definitions to count (and to find containers for) */
+	TArray<const UXIUItemDefinition*> Definitions;
+	/** Value of one item of each definition, used for TotalValue */
+	TMap<const UXIUItemDefinition*, double> Values;
+	/** Only inventories whose owner is inside these bounds are considered (an invalid box means the whole world) */
+	FBox Bounds = FBox(ForceInit);
+	/** If true, fills Containers of the result */
+	bool bFindContainers = false;
+};
+
+struct XYLOINVENTORYUTIL_API FXIUInventoryQueryResult
+{
+	/** Total count of each definition of the query (same order) */
+	TArray<int64> Counts;
+	/** Inventories holding each definition of the query (same order) */
+	TArray<TArray<TWeakObjectPtr<UXIUInventoryComponent>>> Containers;
+	double TotalValue = 0.0;
+	int32 InventoriesVisited = 0;
+};
+
+/**
+ * Keeps track of every UXIUInventoryComponent of the world (they register themselves in BeginPlay and EndPlay).
+ * Queries copy the item counts of every inventory on the game thread (the only step that needs it), then evaluate
+ * the copy in parallel, one inventory per task, and merge the per inventory results without locks.
+ * Also owns the command queue that lets other threads modify inventories without marshalling each change.
+ */
+UCLASS()
+class XYLOINVENTORYUTIL_API UXIUInventoryWorldSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+public:
+	void RegisterInventory(UXIUInventoryComponent* Inventory);
+	void UnregisterInventory(UXIUInventoryComponent* Inventory);
+	const TArray<TWeakObjectPtr<UXIUInventoryComponent>>& GetInventories() const { return Inventories; }
+	
+	/** Runs the query, blocking until done (evaluation is still parallel) */
+	FXIUInventoryQueryResult RunQuery(const FXIUInventoryQuery& Query) const;
+	/** Takes the snapshot now, and evaluates the query on worker threads
+	 * (Containers are weak pointers, so check them when the result is consumed on game thread) */
+	TFuture<FXIUInventoryQueryResult> RunQueryAsync(FXIUInventoryQuery Query) const;
+
+public:
+	UFUNCTION(BlueprintCallable, Category = "Inventory")
+	int64 CountItemsByDefinition(UXIUItemDefinition* ItemDefinition, const FBox& Bounds) const;
+	UFUNCTION(BlueprintCallable, Category = "Inventory")
+	TArray<UXIUInventoryComponent*> FindInventoriesWithItem(UXIUItemDefinition* ItemDefinition, const FBox& Bounds) const;
+	UFUNCTION(BlueprintCallable, Category = "Inventory")
+	double GetTotalValue(const TMap<UXIUItemDefinition*, double>& Values, const FBox& Bounds) const;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+	/* Commands */
+
+public:
+	/** Thread safe and lock free (any number of producers). Commands are applied on game thread after the actors of
+	 * the world ticked, all the commands of an inventory under one change batch */
+	void EnqueueCommand(FXIUInventoryCommand&& Command);
+	/** Same as EnqueueCommand, but the result is also reported through the returned future */
+	TFuture<int32> EnqueueCommandWithFuture(FXIUInventoryCommand&& Command);
+	/** Applies every queued command now (game thread only). Commands are batched per inventory, and inventories run in
+	 * the order they first appear in the queue */
+	void FlushCommands();
+private:
+	void OnWorldPostActorTick(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds);
+	TQueue<FXIUInventoryCommand, EQueueMode::Mpsc> PendingCommands;
+	FDelegateHandle PostActorTickHandle;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+private:
+	/** Read only copy of the registered inventories, safe to use off the game thread */
+	struct FSnapshot
+	{
+		TArray<TWeakObjectPtr<UXIUInventoryComponent>> Inventories;
+		/** items of inventory i are in Items[ItemOffsets[i], ItemOffsets[i + 1]) */
+		TArray<int32> ItemOffsets;
+		TArray<TPair<const UXIUItemDefinition*, int32>> Items;
+	};
+	FSnapshot MakeSnapshot(const FBox& Bounds) const;
+	static FXIUInventoryQueryResult Evaluate(const FSnapshot& Snapshot, const FXIUInventoryQuery& Query);
+	
+	TArray<TWeakObjectPtr<UXIUInventoryComponent>> Inventories;
+};
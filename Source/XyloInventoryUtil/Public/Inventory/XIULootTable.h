@@ -0,0 +1,97 @@
+// Copyright XyloIsCoding 2024
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+#include "Engine/DataAsset.h"
+#include "Inventory/Item/XIUItem.h"
+#include "XIULootTable.generated.h"
+
+class UXIUItemDefinition;
+class UXIULootTable;
+struct FXIULootTableCompiled;
+
+
+USTRUCT(BlueprintType)
+struct FXIULootTableEntry
+{
+	GENERATED_BODY()
+
+	/** Item given when this entry is rolled (ignored if NestedTable is set) */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Loot")
+	TObjectPtr<UXIUItemDefinition> ItemDefinition = nullptr;
+
+	/** If set, rolling this entry evaluates this table (Count times) instead of giving an item */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Loot")
+	TObjectPtr<UXIULootTable> NestedTable = nullptr;
+
+	/** Relative to the weights of the other entries of the table. Entries with no weight are never rolled */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Loot", meta = (ClampMin = 0))
+	float Weight = 1.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Loot", meta = (ClampMin = 1))
+	int32 MinCount = 1;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Loot", meta = (ClampMin = 1))
+	int32 MaxCount = 1;
+};
+
+/** Walker/Vose alias table: samples an index with probability proportional to its weight in O(1) */
+struct XYLOINVENTORYUTIL_API FXIULootAliasTable
+{
+	void Build(TConstArrayView<float> Weights);
+	int32 Sample(const FRandomStream& Stream) const;
+	bool IsEmpty() const { return Probabilities.IsEmpty(); }
+
+private:
+	TArray<float> Probabilities;
+	TArray<int32> Aliases;
+};
+
+/**
+ * Weighted loot table, rolled between MinRolls and MaxRolls times.
+ * The table is compiled (on game thread, on first use) to an immutable alias table shared with nested tables, so
+ * evaluation is O(1) per roll, does not touch any UObject, and can run on any thread. Given the same seed, the
+ * result is always the same.
+ */
+UCLASS(BlueprintType)
+class XYLOINVENTORYUTIL_API UXIULootTable : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Loot")
+	TArray<FXIULootTableEntry> Entries;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Loot", meta = (ClampMin = 0))
+	int32 MinRolls = 1;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Loot", meta = (ClampMin = 0))
+	int32 MaxRolls = 1;
+
+public:
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+	/** Game thread. Items of the same definition are merged (counts can exceed the max count of the item) */
+	UFUNCTION(BlueprintCallable, Category = "Loot")
+	TArray<FXIUItemDefault> Evaluate(const int32 Seed);
+	/** Compiles on the calling thread (must be game thread), then evaluates in a task. The caller must keep the table
+	 * (and the item definitions) referenced until the future is ready */
+	TFuture<TArray<FXIUItemDefault>> EvaluateAsync(const int32 Seed);
+
+	/** Game thread. Compiles the table and its nested tables if needed */
+	TSharedPtr<const FXIULootTableCompiled> GetCompiled();
+	/** Any thread */
+	static void EvaluateCompiled(const FXIULootTableCompiled& Compiled, const int32 Seed, TArray<FXIUItemDefault>& OutItems);
+
+private:
+	TSharedPtr<const FXIULootTableCompiled> Compile(TArray<const UXIULootTable*>& CompileStack);
+	/** @return true if this table or any nested table changed since compiled */
+	bool IsCompiledOutdated() const;
+	TSharedPtr<const FXIULootTableCompiled> Compiled;
+	/** Increased on every edit, so tables nesting this one know their compiled data is outdated */
+	uint32 Version = 0;
+};
@@ -0,0 +1,52 @@
+// Copyright XyloIsCoding 2024
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "XIUNetDormancyComponent.generated.h"
+
+/**
+ * Puts its owner in net dormancy (DORM_DormantAll) once nothing changed for IdleTime, and wakes it up when something
+ * is about to change. An inventory component wakes it before modifying its slots or items (see
+ * UXIUInventoryComponent::WakeOwnerNetDormancy), other code has to call Wake itself.
+ */
+UCLASS(ClassGroup=(Custom), meta=(BlueprintSpawnableComponent), BlueprintType)
+class XYLOINVENTORYUTIL_API UXIUNetDormancyComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UXIUNetDormancyComponent(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	/*
+	 * UActorComponent Interface
+	 */
+
+protected:
+	virtual void BeginPlay() override;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	/*
+	 * NetDormancyComponent
+	 */
+
+public:
+	/** Server. Wakes the owner from net dormancy and restarts the idle time.
+	 * Call before modifying replicated state of the owner, so the change is not lost on dormant channels. */
+	UFUNCTION(BlueprintCallable, Category = "Replication")
+	void Wake();
+private:
+	/** Seconds without changes before the owner goes dormant. Negative disables dormancy. */
+	UPROPERTY(EditAnywhere, Category = "Replication")
+	float IdleTime;
+	/** Set by Wake, so waking an awake owner does not reset the timer every time */
+	double LastWakeTime = 0.0;
+	FTimerHandle IdleTimerHandle;
+	void StartIdleTimer(const float Delay);
+	void OnIdleTimerExpired();
+	
+};